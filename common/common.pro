@@ -32,6 +32,7 @@ SOURCES = applock.cpp              \
           calendargraphicsitem.cpp \
           checkForUpdates.cpp      \
           cmdlinemessagehandler.cpp \
+          dbconnection.cpp \
           errorReporter.cpp        \
           exporthelper.cpp \
           guimessagehandler.cpp \
@@ -40,8 +41,10 @@ SOURCES = applock.cpp              \
           graphicstextbuttonitem.cpp \
           gunzip.cpp \
           login2.cpp \
+          metasqlcache.cpp \
           metrics.cpp \
           metricsenc.cpp \
+          parallelquery.cpp \
           qbase64encode.cpp \
           qmd5.cpp \
           shortcuts.cpp \
@@ -59,6 +62,7 @@ HEADERS = applock.h              \
           calendargraphicsitem.h \
           cmdlinemessagehandler.h \
           checkForUpdates.h      \
+          dbconnection.h \
           errorReporter.h        \
           exporthelper.h \
           importhelper.h \
@@ -67,8 +71,10 @@ HEADERS = applock.h              \
           guimessagehandler.h \
           gunzip.h \
           login2.h \
+          metasqlcache.h \
           metrics.h \
           metricsenc.h \
+          parallelquery.h \
           qbase64encode.h \
           qmd5.h \
           shortcuts.h \
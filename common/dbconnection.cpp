@@ -0,0 +1,146 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "dbconnection.h"
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QVariant>
+#include <QtDebug>
+
+#include "storedProcErrorLookup.h"
+#include "xtsettings.h"
+
+#define DEBUG false
+
+DbConnection::DbConnection(const QSqlDatabase &db)
+  : _driver(db.driverName()),
+    _hostName(db.hostName()),
+    _port(db.port()),
+    _databaseName(db.databaseName()),
+    _userName(db.userName()),
+    _password(db.password()),
+    _options(db.connectOptions()),
+    _readOnly(false),
+    _replica(false)
+{
+}
+
+/*! Describe a read-only session for report queries on the database \a db
+    is connected to. If the ReportingDatabase/host setting is not empty the
+    session is opened on that server instead, which should be a streaming
+    replica of \a db's server; ReportingDatabase/port defaults to \a db's.
+ */
+DbConnection DbConnection::reporting(const QSqlDatabase &db)
+{
+  DbConnection result(db);
+  result._readOnly = true;
+
+  QString host = xtsettingsValue("ReportingDatabase/host").toString().trimmed();
+  if (! host.isEmpty())
+  {
+    result._hostName = host;
+    result._port     = xtsettingsValue("ReportingDatabase/port", db.port()).toInt();
+    result._replica  = true;
+  }
+
+  return result;
+}
+
+bool DbConnection::isValid() const
+{
+  return ! _driver.isEmpty() && ! _databaseName.isEmpty();
+}
+
+/*! Open a new connection called \a name using the captured settings and
+    log in the same way the GUI client does when it reconnects.
+    On failure the connection is removed, \a errmsg describes the problem,
+    and the returned QSqlDatabase is not open.
+
+    Call this from the thread that will use the connection.
+ */
+QSqlDatabase DbConnection::open(const QString &name, QString &errmsg) const
+{
+  if (! isValid())
+  {
+    errmsg = QObject::tr("There is no database connection to copy.");
+    return QSqlDatabase();
+  }
+
+  QSqlDatabase db = QSqlDatabase::addDatabase(_driver, name);
+  db.setHostName(_hostName);
+  db.setPort(_port);
+  db.setDatabaseName(_databaseName);
+  db.setUserName(_userName);
+  db.setPassword(_password);
+  db.setConnectOptions(_options);
+
+  if (! db.open())
+  {
+    errmsg = db.lastError().text();
+    db = QSqlDatabase();
+    remove(name);
+    return QSqlDatabase();
+  }
+
+  QSqlQuery login(db);
+  if (login.exec("SELECT login(true) AS result;") && login.first())
+  {
+    int result = login.value("result").toInt();
+    if (result < 0)
+      errmsg = storedProcErrorLookup("login", result);
+  }
+  else
+    errmsg = login.lastError().text();
+
+  // a replica refuses writes anyway but the primary needs telling
+  if (errmsg.isEmpty() && _readOnly &&
+      ! login.exec("SET SESSION CHARACTERISTICS AS TRANSACTION READ ONLY;"))
+    errmsg = login.lastError().text();
+
+  if (! errmsg.isEmpty())
+  {
+    login = QSqlQuery();
+    db = QSqlDatabase();
+    remove(name);
+    return QSqlDatabase();
+  }
+
+  if (DEBUG)
+    qDebug() << "DbConnection::open() opened" << name;
+  return db;
+}
+
+/*! Return a connection name starting with \a prefix
+    that no other caller of uniqueName() will get.
+ */
+QString DbConnection::uniqueName(const QString &prefix)
+{
+  static QAtomicInt serial(0);
+  return QString("%1%2").arg(prefix).arg(serial.fetchAndAddOrdered(1));
+}
+
+/*! Close and forget the connection called \a name.
+    Callers must not hold any QSqlDatabase or QSqlQuery on it.
+ */
+void DbConnection::remove(const QString &name)
+{
+  if (! QSqlDatabase::contains(name))
+    return;
+
+  {
+    QSqlDatabase db = QSqlDatabase::database(name, false);
+    if (db.isOpen())
+      db.close();
+  }
+  QSqlDatabase::removeDatabase(name);
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __DBCONNECTION_H__
+#define __DBCONNECTION_H__
+
+#include <QSqlDatabase>
+#include <QString>
+
+/* The settings needed to open another session on the database the
+   application is logged in to.
+
+   A QSqlDatabase connection may only be used by the thread that created
+   it, so code that wants to query from a worker thread constructs a
+   DbConnection on the GUI thread, hands it to the worker, and calls
+   open() and remove() from inside the worker.
+
+   reporting() describes the session report queries may use instead of
+   the GUI client's own. It is read only and, if the ReportingDatabase
+   settings name one, on a replica server.
+ */
+class DbConnection
+{
+  public:
+    DbConnection(const QSqlDatabase &db = QSqlDatabase::database());
+
+    bool          isValid() const;
+    bool          isReadOnly() const { return _readOnly; }
+    bool          isReplica()  const { return _replica;  }
+    QSqlDatabase  open(const QString &name, QString &errmsg) const;
+
+    static DbConnection reporting(const QSqlDatabase &db = QSqlDatabase::database());
+    static QString      uniqueName(const QString &prefix);
+    static void         remove(const QString &name);
+
+  private:
+    QString _driver;
+    QString _hostName;
+    int     _port;
+    QString _databaseName;
+    QString _userName;
+    QString _password;
+    QString _options;
+    bool    _readOnly;
+    bool    _replica;
+};
+
+#endif
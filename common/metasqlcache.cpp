@@ -0,0 +1,117 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "metasqlcache.h"
+
+#include <QApplication>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QStringList>
+
+#include <metasql.h>
+#include <mqlutil.h>
+
+#define DEBUG false
+
+MetaSQLCache *MetaSQLCache::_singleton = 0;
+
+MetaSQLCache *MetaSQLCache::cache()
+{
+  if (! _singleton)
+    _singleton = new MetaSQLCache(QApplication::instance());
+
+  return _singleton;
+}
+
+MetaSQLCache::MetaSQLCache(QObject *parent)
+  : QObject(parent)
+{
+}
+
+/* listen to the current database connection. after reconnecting,
+   notifications come from a new driver and anything could have changed.
+ */
+void MetaSQLCache::watch()
+{
+  QSqlDatabase db = QSqlDatabase::database();
+  if (db.driver() == _driver)
+    return;
+
+  clear();
+  _driver = db.driver();
+  if (! _driver)
+    return;
+
+  QStringList tables;
+  tables << "metasql" << "pkghead";
+  foreach (QString table, tables)
+  {
+    if (! _driver->subscribedToNotifications().contains(table))
+      _driver->subscribeToNotification(table);
+  }
+  connect(_driver, SIGNAL(notification(const QString&)), this, SLOT(sNotified(const QString&)));
+}
+
+/*! Return the parsed MetaSQL statement \a group \a name, the way
+    MQLUtil::mqlLoad() would, but only fetch and parse it the first time.
+    On failure this returns a null pointer, sets \a errmsg, and sets
+    \a valid to false if it is given.
+
+    The statement is shared by every caller, so don't change it.
+ */
+QSharedPointer<MetaSQLQuery> MetaSQLCache::load(const QString &group, const QString &name,
+                                                QString &errmsg, bool *valid)
+{
+  MetaSQLCache *self = cache();
+  self->watch();
+  QString key = group + QChar(0x1f) + name;
+
+  QSharedPointer<MetaSQLQuery> result = self->_queries.value(key);
+  if (result)
+  {
+    if (valid)
+      *valid = true;
+    return result;
+  }
+
+  bool ok = false;
+  MetaSQLQuery mql = MQLUtil::mqlLoad(group, name, errmsg, &ok);
+  if (ok)
+  {
+    result = QSharedPointer<MetaSQLQuery>(new MetaSQLQuery(mql));
+    if (result->isValid())
+      self->_queries.insert(key, result);
+    else
+    {
+      errmsg = result->parseLog();
+      result.clear();
+      ok = false;
+    }
+  }
+
+  if (DEBUG)
+    qDebug("MetaSQLCache::load(%s, %s) loaded %d, %d cached",
+           qPrintable(group), qPrintable(name), ok, self->_queries.size());
+
+  if (valid)
+    *valid = ok;
+  return result;
+}
+
+void MetaSQLCache::clear()
+{
+  _queries.clear();
+}
+
+void MetaSQLCache::sNotified(const QString &pNotification)
+{
+  if (pNotification == "metasql" || pNotification == "pkghead")
+    clear();
+}
@@ -0,0 +1,61 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef METASQLCACHE_H
+#define METASQLCACHE_H
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QSqlDriver>
+#include <QString>
+
+class MetaSQLQuery;
+
+/* Parsed MetaSQL statements by group and name, so code that runs the same
+   statement repeatedly doesn't fetch and parse its text every time.
+
+   Statements are loaded with MQLUtil::mqlLoad(), which picks the text
+   from the highest-precedence package. The whole cache is dropped when
+   the metasql or pkghead table raises a notification, since either can
+   change which text mqlLoad() would pick, and when the application
+   connects to the database again. Code that changes a statement itself
+   should clear() it too, and so should whatever notices the database
+   connection was lost. Only use it from the GUI thread.
+ */
+class MetaSQLCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static MetaSQLCache *cache();
+    static QSharedPointer<MetaSQLQuery> load(const QString &group, const QString &name,
+                                             QString &errmsg, bool *valid = 0);
+
+  public slots:
+    void clear();
+
+  protected:
+    MetaSQLCache(QObject *parent = 0);
+
+    static MetaSQLCache *_singleton;
+
+  private slots:
+    void sNotified(const QString &pNotification);
+
+  private:
+    void watch();
+
+    QHash<QString, QSharedPointer<MetaSQLQuery> > _queries;
+    QPointer<QSqlDriver>                          _driver;
+};
+
+#endif
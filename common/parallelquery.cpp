@@ -0,0 +1,124 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "parallelquery.h"
+
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QtDebug>
+
+#define DEBUG false
+
+/* one session of the pool. takes statements until none are left. */
+class ParallelQueryThread : public QThread
+{
+  public:
+    ParallelQueryThread(ParallelQuery *parent) : _parent(parent) {}
+
+  protected:
+    virtual void run()
+    {
+      QString name = DbConnection::uniqueName("parallelquery");
+      QString errmsg;
+      {
+        QSqlDatabase db = _parent->_connection.open(name, errmsg);
+        if (! db.isOpen())
+        {
+          _parent->fail(errmsg);
+          return;
+        }
+
+        ParallelQuery::Job job;
+        while (_parent->takeJob(job))
+        {
+          QSqlQuery query(db);
+          query.prepare(job.sql);
+          for (QMap<QString, QVariant>::const_iterator it = job.bindings.constBegin();
+               it != job.bindings.constEnd(); ++it)
+            query.bindValue(it.key(), it.value());
+          if (! query.exec())
+          {
+            _parent->fail(query.lastError().text());
+            break;
+          }
+        }
+      }
+      DbConnection::remove(name);
+    }
+
+  private:
+    ParallelQuery *_parent;
+};
+
+/*! Prepare to run statements on up to \a threads copies of \a db. */
+ParallelQuery::ParallelQuery(int threads, const QSqlDatabase &db)
+  : _connection(db),
+    _threads(qMax(1, threads)),
+    _next(0)
+{
+}
+
+/*! Add \a sql to the statements to run, with \a bindings bound by name. */
+void ParallelQuery::append(const QString &sql, const QMap<QString, QVariant> &bindings)
+{
+  Job job;
+  job.sql      = sql;
+  job.bindings = bindings;
+  _jobs.append(job);
+}
+
+/*! Run all of the statements and wait for them to finish.
+    Returns false if a session could not be opened or a statement failed,
+    in which case statements that had not started are skipped and
+    errorString() describes the first failure.
+ */
+bool ParallelQuery::exec()
+{
+  _next = 0;
+  _errorString.clear();
+
+  QList<ParallelQueryThread *> threads;
+  for (int i = 0; i < _threads && i < _jobs.size(); i++)
+  {
+    ParallelQueryThread *thread = new ParallelQueryThread(this);
+    threads.append(thread);
+    thread->start();
+  }
+
+  foreach (ParallelQueryThread *thread, threads)
+  {
+    thread->wait();
+    delete thread;
+  }
+
+  if (DEBUG)
+    qDebug() << "ParallelQuery::exec() ran" << _next << "of" << _jobs.size()
+             << "on" << threads.size() << "sessions" << _errorString;
+  return _errorString.isEmpty();
+}
+
+bool ParallelQuery::takeJob(Job &job)
+{
+  QMutexLocker locker(&_mutex);
+  if (! _errorString.isEmpty() || _next >= _jobs.size())
+    return false;
+
+  job = _jobs.at(_next++);
+  return true;
+}
+
+void ParallelQuery::fail(const QString &errmsg)
+{
+  QMutexLocker locker(&_mutex);
+  if (_errorString.isEmpty())
+    _errorString = errmsg;
+}
@@ -0,0 +1,63 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef __PARALLELQUERY_H__
+#define __PARALLELQUERY_H__
+
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVariant>
+
+#include "dbconnection.h"
+
+/* Runs independent statements concurrently, each on one of a small pool
+   of extra sessions on the application's database.
+
+   Statements must not depend on each other or on the state of the GUI
+   client's own session, such as temporary tables or an open transaction,
+   because each one may run in any session of the pool and in any order.
+   Each statement commits on its own.
+
+   Construct this on the GUI thread so it can capture the connection.
+ */
+class ParallelQuery
+{
+  public:
+    ParallelQuery(int threads, const QSqlDatabase &db = QSqlDatabase::database());
+
+    void    append(const QString &sql,
+                   const QMap<QString, QVariant> &bindings = QMap<QString, QVariant>());
+    int     count() const { return _jobs.size(); }
+    bool    exec();
+    QString errorString() const { return _errorString; }
+
+  private:
+    struct Job
+    {
+      QString                 sql;
+      QMap<QString, QVariant> bindings;
+    };
+
+    friend class ParallelQueryThread;
+
+    bool    takeJob(Job &job);
+    void    fail(const QString &errmsg);
+
+    DbConnection _connection;
+    int          _threads;
+    QList<Job>   _jobs;
+    int          _next;         // first job no thread has taken
+    QString      _errorString;
+    QMutex       _mutex;        // guards _next and _errorString during exec()
+};
+
+#endif
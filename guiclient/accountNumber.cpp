@@ -17,6 +17,7 @@
 #include <metasql.h>
 #include <parameter.h>
 #include "errorReporter.h"
+#include "virtualclustercache.h"
 
 accountNumber::accountNumber(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
     : XDialog(parent, name, modal, fl)
@@ -273,6 +274,8 @@ void accountNumber::sSave()
       return;
   }
 
+  // there is no accounts updated signal to do this for us
+  VirtualClusterCache::cache()->invalidate("accnt");
   done(_accntid);
 }
 
@@ -21,6 +21,7 @@
 #include "accountNumber.h"
 #include "storedProcErrorLookup.h"
 #include "errorReporter.h"
+#include "virtualclustercache.h"
 
 accountNumbers::accountNumbers(QWidget* parent, const char* name, Qt::WindowFlags fl)
     : XWidget(parent, name, fl)
@@ -92,6 +93,7 @@ void accountNumbers::sDelete()
                              __FILE__, __LINE__);
         return;
     }
+    VirtualClusterCache::cache()->invalidate("accnt");
     sFillList();
   }
   else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Deleting Account"),
@@ -13,14 +13,16 @@
 #include "ui_display.h"
 
 #include <QSqlError>
+#include <QLabel>
 #include <QMessageBox>
 #include <QPrinter>
 #include <QPrintDialog>
+#include <QScopedPointer>
 #include <QShortcut>
+#include <QTime>
 #include <QToolButton>
 
 #include <metasql.h>
-#include <mqlutil.h>
 #include <orprerender.h>
 #include <orprintrender.h>
 #include <renderobjects.h>
@@ -28,17 +30,27 @@
 #include <previewdialog.h>
 
 #include "parameterlistsetup.h"
+#include "dbconnection.h"
 #include "errorReporter.h"
+#include "displayDiagnostics.h"
 #include "displayprivate.h"
+#include "displayRefreshScheduler.h"
+#include "displayResultCache.h"
+#include "metasqlcache.h"
+#include "xtreewidgetpager.h"
 
 displayPrivate::displayPrivate(::display *parent)
     : QObject(parent),
       _useAltId(false),
+      _queryInBackground(false),
+      _reportingConnection(false),
+      _fillListPending(false),
       _queryOnStartEnabled(false),
       _autoUpdateEnabled(false),
       _filterChanged(false),
       _parent(parent)
 {
+  _pager = 0;
   setupUi(_parent);
 
   _parameterWidget->setVisible(false);
@@ -48,6 +60,11 @@ displayPrivate::displayPrivate(::display *parent)
   _searchLit->hide();
   _listLabelFrame->setVisible(false);
 
+  _staleLit = new QLabel(_parent);
+  _staleLit->setObjectName("_staleLit");
+  _staleLit->setVisible(false);
+  _labelLayout->addWidget(_staleLit);
+
   // Build Toolbar even if we hide it so we get actions
   _newBtn = new QToolButton(_toolBar);
   _newBtn->setObjectName("_newBtn");
@@ -398,6 +415,8 @@ display::display(QWidget* parent, const char* name, Qt::WindowFlags flags)
   connect(this, SIGNAL(fillList()), this, SLOT(sFillList()));
   connect(_data->_list, SIGNAL(populateMenu(QMenu*,QTreeWidgetItem*,int)), this, SLOT(sPopulateMenu(QMenu*,QTreeWidgetItem*,int)));
   connect(_data->_autoupdate, SIGNAL(toggled(bool)), this, SLOT(sAutoUpdateToggled()));
+  connect(_data->_list, SIGNAL(populated()), this, SLOT(sFillListFinished()));
+  connect(_data->_list, SIGNAL(populateFailed(QString)), this, SLOT(sFillListFailed(QString)));
   connect(filterButton, SIGNAL(toggled(bool)), _data->_moreBtn, SLOT(setChecked(bool)));
 }
 
@@ -412,9 +431,19 @@ void display::languageChange()
   _data->retranslateUi(this);
 }
 
+void display::changeEvent(QEvent * e)
+{
+  XWidget::changeEvent(e);
+
+  // restoring a minimized main window does not send the display a showEvent
+  if (e->type() == QEvent::ActivationChange && isActiveWindow())
+    DisplayRefreshScheduler::scheduler()->shown(this);
+}
+
 void display::showEvent(QShowEvent * e)
 {
   XWidget::showEvent(e);
+  DisplayRefreshScheduler::scheduler()->shown(this);
 
   // don't overwrite the user's filter when the window is minimized
   if (! _data->_filterChanged)
@@ -572,6 +601,84 @@ bool display::useAltId() const
   return _data->_useAltId;
 }
 
+/*! When on, sFillList() runs the query on a separate database connection
+    and fills the list as results arrive, leaving the window responsive.
+    fillListAfter() is emitted once the list has been fully populated
+    rather than before sFillList() returns.
+ */
+void display::setQueryInBackground(bool on)
+{
+  _data->_queryInBackground = on;
+}
+
+bool display::queryInBackground() const
+{
+  return _data->_queryInBackground;
+}
+
+/*! When on, sFillList() runs the query in the background on a read-only
+    session opened with DbConnection::reporting() instead of the GUI
+    client's own connection, so a long report doesn't hold up other work.
+
+    Only turn this on for reports whose query just reads committed data:
+    no functions that write, such as ones that fill work tables, no
+    temporary tables or session settings made on the GUI connection, and
+    nothing that must see changes this window hasn't committed yet. If the
+    reporting session is on a replica, the list is labeled with the time
+    it was read since it may be missing the latest changes.
+ */
+void display::setReportingConnection(bool on)
+{
+  _data->_reportingConnection = on;
+}
+
+bool display::reportingConnection() const
+{
+  return _data->_reportingConnection;
+}
+
+/*! Keep the results of sFillList() in a cache shared by all displays,
+    so running the report again with the same parameters refills the list
+    without querying the database. \a tables are the tables the report
+    reads; a notification named after any of them drops the cached
+    results. An empty list, the default, turns the cache off.
+
+    Results are only stored by queries run in the foreground.
+ */
+void display::setResultCacheTables(const QStringList &tables)
+{
+  _data->_resultCacheTables = tables;
+}
+
+QStringList display::resultCacheTables() const
+{
+  return _data->_resultCacheTables;
+}
+
+/*! When on, sFillList() shows the first page of results as soon as the
+    database returns it and fetches more as the list is scrolled, sorted,
+    copied or exported. The rows come from a server-side cursor held open
+    on a separate database session until they have all been fetched.
+ */
+void display::setPagedQuery(bool on)
+{
+  if (on && ! _data->_pager)
+  {
+    _data->_pager = new XTreeWidgetPager(_data->_list);
+    connect(_data->_pager, SIGNAL(failed(QString)), this, SLOT(sFillListFailed(QString)));
+  }
+  else if (! on && _data->_pager)
+  {
+    delete _data->_pager;
+    _data->_pager = 0;
+  }
+}
+
+bool display::pagedQuery() const
+{
+  return _data->_pager != 0;
+}
+
 void display::setNewVisible(bool show)
 {
   _data->_newAct->setVisible(show);
@@ -706,6 +813,26 @@ bool display::autoUpdateEnabled() const
   return _data->_autoUpdateEnabled;
 }
 
+/*! Limit automatic updates to times when one of \a tables raises a
+    database notification. With an empty list, the default, automatic
+    updates happen on every GUIClient::tick().
+
+    The tables need triggers that send NOTIFY with the table name when
+    they change. Until one of them has been heard from, the window keeps
+    updating on every tick, so naming tables without triggers costs
+    nothing but doesn't help either.
+ */
+void display::setAutoUpdateTables(const QStringList &tables)
+{
+  _data->_autoUpdateTables = tables;
+  sAutoUpdateToggled();
+}
+
+QStringList display::autoUpdateTables() const
+{
+  return _data->_autoUpdateTables;
+}
+
 void display::sNew()
 {
 }
@@ -748,6 +875,15 @@ void display::sFillList()
   sFillList(ParameterList());
 }
 
+/*! Refresh the list soon rather than right away. Requests that arrive
+    together are merged into one, and a window that isn't showing waits
+    until it is shown. Connect update signals from GUIClient here.
+ */
+void display::sScheduleFillList()
+{
+  DisplayRefreshScheduler::scheduler()->request(this);
+}
+
 void display::sFillList(ParameterList pParams, bool forceSetParams)
 {
   emit fillListBefore();
@@ -757,17 +893,33 @@ void display::sFillList(ParameterList pParams, bool forceSetParams)
       return;
   }
   int itemid = _data->_list->id();
+  _data->_staleLit->setVisible(false);
+
+  QString cacheKey;
+  if (! _data->_resultCacheTables.isEmpty())
+  {
+    cacheKey = DisplayResultCache::key(_data->metasqlGroup, _data->metasqlName, pParams);
+
+    QSqlRecord          record;
+    XTreeWidgetRowBatch rows;
+    if (DisplayResultCache::cache()->find(cacheKey, record, rows))
+    {
+      _data->_list->populateRows(record, rows, itemid, _data->_useAltId);
+      emit fillListAfter();
+      return;
+    }
+  }
+
   bool ok = true;
   QString errorString;
-  MetaSQLQuery mql = MQLUtil::mqlLoad(_data->metasqlGroup, _data->metasqlName, errorString, &ok);
+  QSharedPointer<MetaSQLQuery> mql = MetaSQLCache::load(_data->metasqlGroup, _data->metasqlName, errorString, &ok);
   if(!ok)
   {
     ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information"),
                          errorString, __FILE__, __LINE__);
     return;
   }
-  XSqlQuery xq = mql.toQuery(pParams, QSqlDatabase(), false);
-
+  QMap<QString, QVariant> bindings;
   QString column;
   QVariant param;
   bool valid;
@@ -777,7 +929,7 @@ void display::sFillList(ParameterList pParams, bool forceSetParams)
     column = QString("char%1").arg(columnid.toString());
     param = pParams.value(column, &valid);
     if (valid)
-      xq.bindValue(QString(":%1").arg(column), param.toString());
+      bindings.insert(QString(":%1").arg(column), param.toString());
   }
 
   foreach (QVariant columnid, _data->_charidslist)
@@ -788,7 +940,7 @@ void display::sFillList(ParameterList pParams, bool forceSetParams)
     {
       QStringList list = param.toStringList();
       for (int j = 0; j < list.count(); j++)
-        xq.bindValue(QString(":%1_%2").arg(column).arg(j), list.at(j));
+        bindings.insert(QString(":%1_%2").arg(column).arg(j), list.at(j));
     }
   }
 
@@ -798,18 +950,82 @@ void display::sFillList(ParameterList pParams, bool forceSetParams)
     column = QString("char%1startDate").arg(columnid.toString());
     param = pParams.value(column, &valid);
     if (valid)
-      xq.bindValue(QString(":%1").arg(column), param.toString());
+      bindings.insert(QString(":%1").arg(column), param.toString());
 
     // Look for end date
     column = QString("char%1endDate").arg(columnid.toString());
     param = pParams.value(column, &valid);
     if (valid)
-      xq.bindValue(QString(":%1").arg(column), param.toString());
+      bindings.insert(QString(":%1").arg(column), param.toString());
+  }
+
+  if (_data->_pager)
+  {
+    // failures are reported by sFillListFailed()
+    if (_data->_pager->open(mql->getSource(), pParams, bindings,
+                            itemid, _data->_useAltId))
+      emit fillListAfter();
+    return;
   }
 
+  if (_data->_queryInBackground || _data->_reportingConnection)
+  {
+    DbConnection connection = _data->_reportingConnection ?
+                              DbConnection::reporting() : DbConnection();
+    if (connection.isReplica())
+    {
+      _data->_staleLit->setText(tr("Read from the reporting database at %1; recent changes may not appear.")
+                                .arg(QTime::currentTime().toString(Qt::DefaultLocaleShortDate)));
+      _data->_staleLit->setVisible(true);
+    }
+
+    _data->_fillListPending = true;
+    _data->_list->populateAsync(mql->getSource(), pParams, bindings,
+                                itemid, _data->_useAltId, connection);
+    return;
+  }
+
+  QScopedPointer<DisplayDiagnostics> diagnostics;
+  if (DisplayDiagnostics::isEnabled())
+    diagnostics.reset(new DisplayDiagnostics(objectName(), _data->metasqlGroup,
+                                             _data->metasqlName));
+
+  XSqlQuery xq = mql->toQuery(pParams, QSqlDatabase(), false);
+  for (QMap<QString, QVariant>::const_iterator it = bindings.constBegin();
+       it != bindings.constEnd(); ++it)
+    xq.bindValue(it.key(), it.value());
+  if (diagnostics)
+    diagnostics->lap("expand");
+
   xq.exec();
+  if (diagnostics)
+  {
+    diagnostics->lap("execute");
+    diagnostics->setRows(xq.size());
+  }
+
+  if (! cacheKey.isEmpty() && xq.lastError().type() == QSqlError::NoError)
+  {
+    QSqlRecord          record = xq.record();
+    XTreeWidgetRowBatch rows(record.count());
+    while (xq.next())
+      rows.append(xq);
+    DisplayResultCache::cache()->insert(cacheKey, _data->_resultCacheTables,
+                                        record, rows);
+    _data->_list->populateRows(record, rows, itemid, _data->_useAltId);
+  }
+  else
+    _data->_list->populate(xq, itemid, _data->_useAltId);
+
+  if (diagnostics)
+  {
+    diagnostics->lap("populate");
+    if (DisplayDiagnostics::isExplainEnabled() &&
+        xq.lastError().type() == QSqlError::NoError)
+      diagnostics->explain(xq);
+    diagnostics->write(pParams);
+  }
 
-  _data->_list->populate(xq, itemid, _data->_useAltId);
   if (xq.lastError().type() != QSqlError::NoError)
   {
     ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information"),
@@ -823,13 +1039,29 @@ void display::sPopulateMenu(QMenu *, QTreeWidgetItem *, int)
 {
 }
 
+void display::sFillListFinished()
+{
+  if (! _data->_fillListPending)
+    return;
+
+  _data->_fillListPending = false;
+  emit fillListAfter();
+}
+
+void display::sFillListFailed(const QString &message)
+{
+  _data->_fillListPending = false;
+  ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information"),
+                       message, __FILE__, __LINE__);
+}
+
 void display::sAutoUpdateToggled()
 {
   bool update = _data->_autoUpdateEnabled && _data->_autoupdate->isChecked();
   if (update)
-    connect(omfgThis, SIGNAL(tick()), this, SLOT(sFillList()));
+    DisplayRefreshScheduler::scheduler()->watch(this, _data->_autoUpdateTables);
   else
-    disconnect(omfgThis, SIGNAL(tick()), this, SLOT(sFillList()));
+    DisplayRefreshScheduler::scheduler()->unwatch(this);
 }
 
 ParameterList display::getParams()
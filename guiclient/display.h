@@ -38,6 +38,15 @@ public:
     Q_INVOKABLE void setUseAltId(bool);
     Q_INVOKABLE bool useAltId() const;
 
+    Q_INVOKABLE void setQueryInBackground(bool);
+    Q_INVOKABLE bool queryInBackground() const;
+    Q_INVOKABLE void setReportingConnection(bool);
+    Q_INVOKABLE bool reportingConnection() const;
+    Q_INVOKABLE void setResultCacheTables(const QStringList &);
+    Q_INVOKABLE QStringList resultCacheTables() const;
+    Q_INVOKABLE void setPagedQuery(bool);
+    Q_INVOKABLE bool pagedQuery() const;
+
     Q_INVOKABLE void setNewVisible(bool);
     Q_INVOKABLE bool newVisible() const;
 
@@ -60,6 +69,8 @@ public:
 
     Q_INVOKABLE void setAutoUpdateEnabled(bool);
     Q_INVOKABLE bool autoUpdateEnabled() const;
+    Q_INVOKABLE void setAutoUpdateTables(const QStringList &);
+    Q_INVOKABLE QStringList autoUpdateTables() const;
 
     Q_INVOKABLE XTreeWidget * list();
     Q_INVOKABLE ParameterWidget * parameterWidget();
@@ -92,15 +103,19 @@ public slots:
     virtual void sPreview(ParameterList, bool = false);
     virtual void sFillList();
     virtual void sFillList(ParameterList, bool = false);
+    virtual void sScheduleFillList();
     virtual void sPopulateMenu(QMenu *, QTreeWidgetItem *, int);
 
 protected:
     Q_INVOKABLE ParameterList getParams();
     virtual void showEvent(QShowEvent*);
+    virtual void changeEvent(QEvent*);
 
 protected slots:
     virtual void languageChange();
     virtual void sAutoUpdateToggled();
+    virtual void sFillListFinished();
+    virtual void sFillListFailed(const QString &);
 
 signals:
     void fillList();
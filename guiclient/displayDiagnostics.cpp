@@ -0,0 +1,169 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "displayDiagnostics.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMapIterator>
+#include <QRegExp>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QTextStream>
+
+#include <xsqlquery.h>
+
+#include "dbconnection.h"
+#include "xtsettings.h"
+
+#define DEBUG false
+
+/*! Start timing a refresh of \a window, which runs MetaSQL statement
+    \a name from \a group.
+ */
+DisplayDiagnostics::DisplayDiagnostics(const QString &window,
+                                       const QString &group,
+                                       const QString &name)
+  : _window(window),
+    _query(group + "/" + name),
+    _started(QDateTime::currentDateTime()),
+    _rows(-1),
+    _serverTime(-1)
+{
+  _total.start();
+  _phase.start();
+}
+
+bool DisplayDiagnostics::isEnabled()
+{
+  return xtsettingsValue("DisplayDiagnostics", false).toBool();
+}
+
+bool DisplayDiagnostics::isExplainEnabled()
+{
+  return isEnabled() &&
+         xtsettingsValue("DisplayDiagnosticsExplain", false).toBool();
+}
+
+QString DisplayDiagnostics::fileName()
+{
+  QString name = xtsettingsValue("DisplayDiagnosticsFile").toString();
+  if (name.isEmpty())
+    name = QDir(QStandardPaths::writableLocation(QStandardPaths::DataLocation))
+             .filePath("display-diagnostics.log");
+  return name;
+}
+
+/*! Record the time since the previous lap, or since construction,
+    as the time spent in \a phase.
+ */
+void DisplayDiagnostics::lap(const QString &phase)
+{
+  _laps.append(qMakePair(phase, _phase.restart()));
+}
+
+/*! Capture the plan of \a query, which must already have been executed,
+    by running it again under EXPLAIN (ANALYZE, BUFFERS). This runs on a
+    session of its own so the transaction that rolls back anything the
+    statement writes can't touch one the caller has open.
+ */
+void DisplayDiagnostics::explain(const XSqlQuery &query)
+{
+  QString name = DbConnection::uniqueName("displaydiagnostics");
+  {
+    QString      errmsg;
+    QSqlDatabase db = DbConnection().open(name, errmsg);
+    if (! db.isOpen())
+      _plan << QString("EXPLAIN failed: %1").arg(errmsg);
+    else
+    {
+      QSqlQuery begin("BEGIN;", db);
+
+      QSqlQuery plan(db);
+      plan.prepare("EXPLAIN (ANALYZE, BUFFERS) " + query.lastQuery());
+      QMapIterator<QString, QVariant> it(query.boundValues());
+      while (it.hasNext())
+      {
+        it.next();
+        plan.bindValue(it.key(), it.value());
+      }
+
+      QRegExp executionTime("Execution (?:time|Time): ([0-9.]+) ms");
+      if (plan.exec())
+      {
+        while (plan.next())
+        {
+          QString line = plan.value(0).toString();
+          if (executionTime.indexIn(line) >= 0)
+            _serverTime = executionTime.cap(1).toDouble();
+          _plan << line;
+        }
+      }
+      else
+        _plan << QString("EXPLAIN failed: %1").arg(plan.lastError().text());
+
+      QSqlQuery rollback("ROLLBACK;", db);
+    }
+  }
+  DbConnection::remove(name);
+  _phase.restart();     // don't charge the EXPLAIN to the next phase
+}
+
+/*! Append what was recorded, with the \a params the report ran with,
+    to fileName(). Returns false if the file could not be written.
+ */
+bool DisplayDiagnostics::write(const ParameterList &params)
+{
+  QString filename = fileName();
+  QDir().mkpath(QFileInfo(filename).absolutePath());
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+  {
+    if (DEBUG)
+      qDebug("DisplayDiagnostics::write() could not open %s: %s",
+             qPrintable(filename), qPrintable(file.errorString()));
+    return false;
+  }
+
+  QTextStream out(&file);
+  out << _started.toString(Qt::ISODate) << " " << _window
+      << " (" << _query << ")";
+  if (_rows >= 0)
+    out << " rows=" << _rows;
+  out << "\n";
+
+  QStringList paramList;
+  for (int i = 0; i < params.count(); i++)
+    paramList << QString("%1=%2").arg(params.name(i), params.value(i).toString());
+  out << "  parameters: " << paramList.join(", ") << "\n";
+
+  QStringList lapList;
+  qint64      execute = -1;
+  for (int i = 0; i < _laps.size(); i++)
+  {
+    lapList << QString("%1 %2 ms").arg(_laps.at(i).first).arg(_laps.at(i).second);
+    if (_laps.at(i).first == "execute")
+      execute = _laps.at(i).second;
+  }
+  lapList << QString("total %1 ms").arg(_total.elapsed());
+  out << "  timings: " << lapList.join(", ") << "\n";
+
+  // the driver receives the whole result inside exec()
+  if (_serverTime >= 0 && execute >= 0)
+    out << "  server " << _serverTime << " ms, transfer and network about "
+        << qMax(0.0, execute - _serverTime) << " ms\n";
+
+  foreach (QString line, _plan)
+    out << "    " << line << "\n";
+
+  return out.status() == QTextStream::Ok;
+}
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef DISPLAYDIAGNOSTICS_H
+#define DISPLAYDIAGNOSTICS_H
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+#include <parameter.h>
+
+class XSqlQuery;
+
+/* Timings and query plans for one display refresh, appended to a local
+   file so an administrator can see where a slow report spends its time.
+
+   Turned on with the DisplayDiagnostics setting. DisplayDiagnosticsExplain
+   also captures EXPLAIN (ANALYZE, BUFFERS) of the expanded statement, which
+   runs the query a second time on a separate session, inside a transaction
+   that is rolled back.
+   DisplayDiagnosticsFile names the file, by default
+   display-diagnostics.log in the application's data directory.
+ */
+class DisplayDiagnostics
+{
+  public:
+    DisplayDiagnostics(const QString &window, const QString &group,
+                       const QString &name);
+
+    static bool isEnabled();
+    static bool isExplainEnabled();
+    static QString fileName();
+
+    void lap(const QString &phase);
+    void setRows(int rows) { _rows = rows; }
+    void explain(const XSqlQuery &query);
+    bool write(const ParameterList &params);
+
+  private:
+    QString                       _window;
+    QString                       _query;
+    QDateTime                     _started;
+    QElapsedTimer                 _total;
+    QElapsedTimer                 _phase;
+    QList<QPair<QString, qint64> > _laps;
+    int                           _rows;
+    QStringList                   _plan;
+    double                        _serverTime;   // ms, from the plan
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "displayRefreshScheduler.h"
+
+#include <QApplication>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+
+#include "display.h"
+#include "guiclient.h"
+#include "xtreewidget.h"
+
+#define DEBUG false
+
+#define COALESCEDELAY    500
+#define DISPATCHINTERVAL 100
+#define MAXREFRESHES     2
+
+DisplayRefreshScheduler *DisplayRefreshScheduler::_singleton = 0;
+
+DisplayRefreshScheduler *DisplayRefreshScheduler::scheduler()
+{
+  if (! _singleton)
+    _singleton = new DisplayRefreshScheduler(QApplication::instance());
+
+  return _singleton;
+}
+
+DisplayRefreshScheduler::DisplayRefreshScheduler(QObject *parent)
+  : QObject(parent)
+{
+  _coalesce.setSingleShot(true);
+  _coalesce.setInterval(COALESCEDELAY);
+  _dispatch.setSingleShot(true);
+  connect(&_coalesce, SIGNAL(timeout()), this, SLOT(sQueuePending()));
+  connect(&_dispatch, SIGNAL(timeout()), this, SLOT(sDispatch()));
+
+  if (omfgThis)
+    connect(omfgThis, SIGNAL(tick()), this, SLOT(sTick()));
+
+  QSqlDatabase db = QSqlDatabase::database();
+  if (db.driver())
+    connect(db.driver(), SIGNAL(notification(const QString&)), this, SLOT(sNotified(const QString&)));
+}
+
+/*! Refresh \a window soon. Requests for a window that is already waiting
+    to refresh are merged into the one it is waiting for.
+ */
+void DisplayRefreshScheduler::request(display *window)
+{
+  if (! window || _pending.contains(window) || _queue.contains(window))
+    return;
+
+  if (! _watched.contains(window) && ! _tables.contains(window))
+    connect(window, SIGNAL(destroyed(QObject*)), this, SLOT(sDestroyed(QObject*)), Qt::UniqueConnection);
+
+  _pending.append(window);
+  if (! _coalesce.isActive())   // don't postpone the burst's first request forever
+    _coalesce.start();
+}
+
+/*! Call when \a window is shown so it catches up on refreshes it missed. */
+void DisplayRefreshScheduler::shown(display *window)
+{
+  if (_stale.removeAll(window) > 0)
+  {
+    _queue.append(window);
+    _dispatch.start(0);
+  }
+}
+
+/*! Refresh \a window on every tick, or when one of \a tables changes
+    once any of them is known to send notifications.
+ */
+void DisplayRefreshScheduler::watch(display *window, const QStringList &tables)
+{
+  if (! window)
+    return;
+
+  connect(window, SIGNAL(destroyed(QObject*)), this, SLOT(sDestroyed(QObject*)), Qt::UniqueConnection);
+  _watched.insert(window, window);
+  if (tables.isEmpty())
+    _tables.remove(window);
+  else
+  {
+    _tables.insert(window, tables);
+    foreach (QString table, tables)
+      subscribe(table);
+  }
+}
+
+void DisplayRefreshScheduler::unwatch(display *window)
+{
+  _watched.remove(window);
+  _tables.remove(window);
+}
+
+/* windows whose tables haven't sent a notification yet may be reading
+   tables without NOTIFY triggers, so they still refresh on the tick
+ */
+void DisplayRefreshScheduler::sTick()
+{
+  foreach (QPointer<display> window, _watched)
+  {
+    if (! window)
+      continue;
+
+    bool notifying = false;
+    foreach (QString table, _tables.value(window))
+      notifying |= _heard.contains(table);
+    if (! notifying)
+      request(window);
+  }
+}
+
+void DisplayRefreshScheduler::sNotified(const QString &pNotification)
+{
+  _heard.insert(pNotification);
+  for (QHash<QObject *, QStringList>::const_iterator it = _tables.constBegin();
+       it != _tables.constEnd(); ++it)
+  {
+    if (it.value().contains(pNotification))
+      request(_watched.value(it.key()));
+  }
+}
+
+void DisplayRefreshScheduler::sQueuePending()
+{
+  foreach (QPointer<display> window, _pending)
+  {
+    if (window && ! _queue.contains(window))
+      _queue.append(window);
+  }
+  _pending.clear();
+  sDispatch();
+}
+
+/* start the next refresh. a foreground query blocks until it is done,
+   so only one is started per pass to let the GUI handle events between.
+ */
+void DisplayRefreshScheduler::sDispatch()
+{
+  for (int i = _running.size() - 1; i >= 0; i--)
+  {
+    if (! _running.at(i) || ! _running.at(i)->list()->isFetching())
+      _running.removeAt(i);
+  }
+
+  while (! _queue.isEmpty() && _running.size() < MAXREFRESHES)
+  {
+    QPointer<display> window = _queue.takeFirst();
+    if (! window)
+      continue;
+
+    if (! isShowing(window))
+    {
+      if (! _stale.contains(window))
+        _stale.append(window);
+      continue;
+    }
+
+    if (DEBUG)
+      qDebug("DisplayRefreshScheduler::sDispatch() refreshing %s",
+             qPrintable(window->objectName()));
+    window->sFillList();
+    if (window && window->list()->isFetching())
+      _running.append(window);
+    break;
+  }
+
+  if (! _queue.isEmpty())
+    _dispatch.start(_running.size() < MAXREFRESHES ? 0 : DISPATCHINTERVAL);
+}
+
+/* the window's QPointers are already null, so drop every null one */
+void DisplayRefreshScheduler::sDestroyed(QObject *window)
+{
+  _watched.remove(window);
+  _tables.remove(window);
+  _pending.removeAll(QPointer<display>());
+  _queue.removeAll(QPointer<display>());
+  _running.removeAll(QPointer<display>());
+  _stale.removeAll(QPointer<display>());
+}
+
+bool DisplayRefreshScheduler::isShowing(display *window) const
+{
+  // don't test visibleRegion(); a window covered by another subwindow gets
+  // no showEvent when it is raised, so it would never catch up
+  return window->isVisible() && ! window->window()->isMinimized();
+}
+
+void DisplayRefreshScheduler::subscribe(const QString &table)
+{
+  QSqlDatabase db = QSqlDatabase::database();
+  if (db.driver() && ! db.driver()->subscribedToNotifications().contains(table))
+    db.driver()->subscribeToNotification(table);
+}
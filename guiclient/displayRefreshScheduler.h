@@ -0,0 +1,77 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef DISPLAYREFRESHSCHEDULER_H
+#define DISPLAYREFRESHSCHEDULER_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+class display;
+
+/* Decides when display windows re-run their queries.
+
+   Requests that arrive close together, such as a burst of GUIClient
+   update signals, are merged into one refresh per window. Windows that
+   are hidden or minimized are only marked stale and refresh when they are
+   shown again. Refreshes are started one at a time, with at most a few
+   background queries running at once.
+
+   Windows with autoupdate turned on refresh on every GUIClient::tick(),
+   unless they name the tables they read and one of those tables has
+   raised a database notification; then they refresh on notifications
+   instead. Nothing has to send the notifications, so until one arrives
+   the tick remains the fallback.
+ */
+class DisplayRefreshScheduler : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static DisplayRefreshScheduler *scheduler();
+
+    void request(display *window);
+    void shown(display *window);
+    void watch(display *window, const QStringList &tables);
+    void unwatch(display *window);
+
+  protected:
+    DisplayRefreshScheduler(QObject *parent = 0);
+
+    static DisplayRefreshScheduler *_singleton;
+
+  private slots:
+    void sTick();
+    void sNotified(const QString &pNotification);
+    void sQueuePending();
+    void sDispatch();
+    void sDestroyed(QObject *window);
+
+  private:
+    bool isShowing(display *window) const;
+    void subscribe(const QString &table);
+
+    QHash<QObject *, QPointer<display> > _watched;  // autoupdate windows
+    QHash<QObject *, QStringList>        _tables;   // what they depend on
+    QList<QPointer<display> >            _pending;  // waiting out a burst
+    QList<QPointer<display> >            _queue;    // ready to refresh
+    QList<QPointer<display> >            _running;  // background queries
+    QList<QPointer<display> >            _stale;    // waiting to be shown
+    QSet<QString>                        _heard;    // tables that notify
+    QTimer                               _coalesce;
+    QTimer                               _dispatch;
+};
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "displayResultCache.h"
+
+#include <limits>
+
+#include <QApplication>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+
+#include "guiclient.h"
+
+#define DEBUG false
+
+#define DEFAULTBUDGET (32 * 1024 * 1024)
+#define PRUNEINTERVAL 64
+
+DisplayResultCache *DisplayResultCache::_singleton = 0;
+
+DisplayResultCache *DisplayResultCache::cache()
+{
+  if (! _singleton)
+    _singleton = new DisplayResultCache(QApplication::instance());
+
+  return _singleton;
+}
+
+DisplayResultCache::DisplayResultCache(QObject *parent)
+  : QObject(parent),
+    _stored(0)
+{
+  setBudget(DEFAULTBUDGET);
+
+  QSqlDatabase db = QSqlDatabase::database();
+  if (db.driver())
+    connect(db.driver(), SIGNAL(notification(const QString&)), this, SLOT(invalidate(const QString&)));
+  if (omfgThis)
+    connect(omfgThis, SIGNAL(dbConnectionLost()), this, SLOT(clear()));
+}
+
+/* the same report run with the same parameters, in any order, gets the
+   same key. bindings are derived from the parameters so aren't included.
+ */
+QString DisplayResultCache::key(const QString &group, const QString &name,
+                                const ParameterList &params)
+{
+  QStringList parts;
+  for (int i = 0; i < params.count(); i++)
+  {
+    QVariant value = params.value(i);
+    QString  text  = (value.type() == QVariant::StringList ||
+                      value.type() == QVariant::List) ?
+                     value.toStringList().join(QChar(0x1e)) : value.toString();
+    parts << params.name(i) + QChar(0x1f) + QString(value.typeName()) +
+             QChar(0x1f) + text;
+  }
+  parts.sort();
+
+  return group + QChar(0x1d) + name + QChar(0x1d) + parts.join(QChar(0x1d));
+}
+
+/*! Copy the result stored under \a key into \a record and \a rows.
+    Returns false if there is none.
+ */
+bool DisplayResultCache::find(const QString &key, QSqlRecord &record, XTreeWidgetRowBatch &rows)
+{
+  Entry *entry = _entries.object(key);
+  if (! entry)
+    return false;
+
+  record = entry->record;
+  rows   = entry->rows;
+  if (DEBUG)
+    qDebug("DisplayResultCache::find() hit with %d rows", rows.rowCount());
+  return true;
+}
+
+/*! Store a result under \a key until one of \a tables is notified,
+    the database connection is lost, or it is the least recently used
+    entry when the budget runs out. Without \a tables nothing is stored.
+ */
+void DisplayResultCache::insert(const QString &key, const QStringList &tables,
+                                const QSqlRecord &record, const XTreeWidgetRowBatch &rows)
+{
+  if (tables.isEmpty())
+    return;
+
+  qint64 bytes = sizeof(Entry) + key.size() * sizeof(QChar);
+  for (int row = 0; row < rows.rowCount(); row++)
+  {
+    for (int field = 0; field < rows.fieldCount(); field++)
+    {
+      QVariant value = rows.value(row, field);
+      bytes += sizeof(QVariant);
+      if (value.type() == QVariant::String)
+        bytes += value.toString().size() * sizeof(QChar);
+      else if (value.type() == QVariant::ByteArray)
+        bytes += value.toByteArray().size();
+    }
+  }
+
+  Entry *entry  = new Entry;
+  entry->record = record;
+  entry->rows   = rows;
+  if (! _entries.insert(key, entry, qMax(1, int(bytes / 1024))))
+    return;     // bigger than the whole budget
+
+  foreach (QString table, tables)
+  {
+    subscribe(table);
+    _keys[table].insert(key);
+  }
+
+  if (++_stored >= PRUNEINTERVAL)
+    prune();
+}
+
+qint64 DisplayResultCache::budget() const
+{
+  return qint64(_entries.maxCost()) * 1024;
+}
+
+/*! Limit the memory used by cached rows to roughly \a bytes. */
+void DisplayResultCache::setBudget(qint64 bytes)
+{
+  _entries.setMaxCost(int(qMin(bytes / 1024, qint64(std::numeric_limits<int>::max()))));
+}
+
+void DisplayResultCache::clear()
+{
+  _entries.clear();
+  _keys.clear();
+  _stored = 0;
+}
+
+void DisplayResultCache::invalidate(const QString &table)
+{
+  QHash<QString, QSet<QString> >::iterator it = _keys.find(table);
+  if (it == _keys.end())
+    return;
+
+  foreach (QString key, it.value())
+    _entries.remove(key);
+  _keys.erase(it);
+
+  if (DEBUG)
+    qDebug("DisplayResultCache::invalidate(%s)", qPrintable(table));
+}
+
+void DisplayResultCache::subscribe(const QString &table)
+{
+  QSqlDatabase db = QSqlDatabase::database();
+  if (db.driver() && ! db.driver()->subscribedToNotifications().contains(table))
+    db.driver()->subscribeToNotification(table);
+}
+
+/* forget keys of entries that were evicted to make room for others */
+void DisplayResultCache::prune()
+{
+  _stored = 0;
+
+  QHash<QString, QSet<QString> >::iterator it = _keys.begin();
+  while (it != _keys.end())
+  {
+    QSet<QString>::iterator key = it.value().begin();
+    while (key != it.value().end())
+    {
+      if (_entries.contains(*key))
+        ++key;
+      else
+        key = it.value().erase(key);
+    }
+
+    if (it.value().isEmpty())
+      it = _keys.erase(it);
+    else
+      ++it;
+  }
+}
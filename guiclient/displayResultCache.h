@@ -0,0 +1,74 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef DISPLAYRESULTCACHE_H
+#define DISPLAYRESULTCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QSqlRecord>
+#include <QStringList>
+
+#include <parameter.h>
+
+#include "xtreewidgetfetcher.h"
+
+/* Query results shared by all display windows, so reopening a report with
+   the same MetaSQL query and parameters doesn't go back to the database.
+
+   Entries are charged for the memory their rows use and the least
+   recently used ones are dropped once the budget is exceeded. An entry
+   is also dropped when any of the tables it was stored with raises a
+   notification, so reports only use the cache if they name the tables
+   they read and the database notifies listeners when those change.
+ */
+class DisplayResultCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static DisplayResultCache *cache();
+
+    static QString key(const QString &group, const QString &name,
+                       const ParameterList &params);
+
+    bool   find(const QString &key, QSqlRecord &record, XTreeWidgetRowBatch &rows);
+    void   insert(const QString &key, const QStringList &tables,
+                  const QSqlRecord &record, const XTreeWidgetRowBatch &rows);
+    qint64 budget() const;
+    void   setBudget(qint64 bytes);
+
+  public slots:
+    void   clear();
+    void   invalidate(const QString &table);
+
+  protected:
+    DisplayResultCache(QObject *parent = 0);
+
+  private:
+    struct Entry
+    {
+      QSqlRecord          record;
+      XTreeWidgetRowBatch rows;
+    };
+
+    void   subscribe(const QString &table);
+    void   prune();
+
+    static DisplayResultCache *_singleton;
+
+    QCache<QString, Entry>          _entries;  // cost in KB
+    QHash<QString, QSet<QString> >  _keys;     // cache keys by table
+    int                             _stored;   // inserts since last prune()
+};
+
+#endif
@@ -12,9 +12,17 @@
 #include "ui_displayTimePhased.h"
 
 #include <QSqlError>
+#include <QSqlField>
+#include <QSqlRecord>
 #include <QMessageBox>
 
+#include <metasql.h>
 #include <parameter.h>
+#include <xsqlquery.h>
+
+#include "errorReporter.h"
+#include "metasqlcache.h"
+#include "xtreewidgetfetcher.h"
 
 
 class displayTimePhasedPrivate : public Ui::displayTimePhased
@@ -27,6 +35,8 @@ public:
   }
 
   int _baseColumns;
+  QString _pivotGroup;
+  QString _pivotName;
 
 private:
   ::displayTimePhased * _parent;
@@ -89,6 +99,27 @@ void displayTimePhased::setBaseColumns(int columns)
   _data->_baseColumns = columns;
 }
 
+/*! Fill the list from a long-form MetaSQL query instead of the one set
+    with setMetaSQLOptions(). The server then runs one query no matter how
+    many periods are selected, and the rows are turned into period columns
+    here.
+
+    The query returns one row per list row and period. Its period_id
+    column names the calendar period. The bucket column holds the value,
+    and columns named bucket_<role>, such as bucket_xtnumericrole, hold
+    that value's XTreeWidget roles. All other columns identify the list
+    row and appear once. Every list row gets bucket_<period id> and
+    bucket_<period id>_<role> columns for each selected period, the same
+    as the per-period query builds. Periods with no row show 0.
+
+    An empty \a name turns the pivot off.
+ */
+void displayTimePhased::setPivotMetaSQLOptions(const QString &group, const QString &name)
+{
+  _data->_pivotGroup = group;
+  _data->_pivotName  = name;
+}
+
 void displayTimePhased::sFillList()
 {
   ParameterList params;
@@ -113,6 +144,121 @@ void displayTimePhased::sFillList()
     _columnDates.append(DatePair(cursor->startDate(), cursor->endDate()));
   }
 
-  display::sFillList();
+  if (! _data->_pivotName.isEmpty())
+    fillListPivot(params);
+  else
+    display::sFillList();
+}
+
+/* one pass over the long-form rows, with a hash from row key to list row */
+void displayTimePhased::fillListPivot(ParameterList &params)
+{
+  emit fillListBefore();
+
+  bool ok = true;
+  QString errorString;
+  QSharedPointer<MetaSQLQuery> mql = MetaSQLCache::load(_data->_pivotGroup, _data->_pivotName, errorString, &ok);
+  if (! ok)
+  {
+    ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information"),
+                         errorString, __FILE__, __LINE__);
+    return;
+  }
+
+  XSqlQuery longq = mql->toQuery(params);
+  if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information"),
+                           longq, __FILE__, __LINE__))
+    return;
+
+  QSqlRecord source      = longq.record();
+  int        periodField = source.indexOf("period_id");
+  QList<int> keyFields;
+  QList<int> bucketFields;
+  for (int i = 0; i < source.count(); i++)
+  {
+    QString name = source.fieldName(i);
+    if (i == periodField)
+      continue;
+    else if (name == "bucket" || name.startsWith("bucket_"))
+      bucketFields.append(i);
+    else
+      keyFields.append(i);
+  }
+
+  // the wide record: key columns, then each period's bucket columns
+  QSqlRecord      record;
+  QHash<int, int> periodColumn;
+  foreach (int field, keyFields)
+    record.append(source.field(field));
+  QList<XTreeWidgetItem*> selected = _data->_periods->selectedItems();
+  for (int i = 0; i < selected.size(); i++)
+  {
+    QString bucketname = QString("bucket_%1").arg(selected.at(i)->id());
+    periodColumn.insert(selected.at(i)->id(), record.count());
+    foreach (int field, bucketFields)
+    {
+      QSqlField bucket = source.field(field);
+      bucket.setName(bucketname + source.fieldName(field).mid(6));
+      record.append(bucket);
+    }
+  }
+
+  QHash<QString, int>        rowOf;
+  QVector<QVector<QVariant> > rows;
+  while (longq.next())
+  {
+    // mark NULLs so they don't share a row with empty strings
+    QString key;
+    foreach (int field, keyFields)
+    {
+      QVariant value = longq.value(field);
+      key += (value.isNull() ? QChar('N') : QChar('V')) + value.toString() + QChar(0x1f);
+    }
+
+    int row = rowOf.value(key, -1);
+    if (row < 0)
+    {
+      row = rows.size();
+      rowOf.insert(key, row);
+
+      QVector<QVariant> values(record.count());
+      int column = 0;
+      foreach (int field, keyFields)
+        values[column++] = longq.value(field);
+      /* a period with no long-form row shows 0. its roles, e.g. colors,
+         stay empty rather than take this period's, but it keeps the
+         row's numeric format so the 0 looks like the other buckets */
+      for (int i = 0; i < selected.size(); i++)
+      {
+        foreach (int field, bucketFields)
+        {
+          QString name = source.fieldName(field);
+          if (name == "bucket")
+            values[column++] = QVariant(0);
+          else if (name == "bucket_xtnumericrole")
+            values[column++] = longq.value(field);
+          else
+            values[column++] = QVariant();
+        }
+      }
+      rows.append(values);
+    }
+
+    int column = periodColumn.value(longq.value(periodField).toInt(), -1);
+    if (column < 0)
+      continue;       // a period that isn't selected
+    foreach (int field, bucketFields)
+      rows[row][column++] = longq.value(field);
+  }
+  if (ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Information"),
+                           longq, __FILE__, __LINE__))
+    return;
+
+  XTreeWidgetRowBatch batch(record.count());
+  for (int i = 0; i < rows.size(); i++)
+    batch.append(rows.at(i));
+  list()->populateRows(record, batch, list()->id(), useAltId());
+
+  emit fillListAfter();
 }
 
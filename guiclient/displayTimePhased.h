@@ -29,6 +29,8 @@ public:
 
     virtual bool setParams(ParameterList &);
 
+    Q_INVOKABLE void setPivotMetaSQLOptions(const QString &, const QString &);
+
 public slots:
     virtual void sFillList();
 
@@ -36,6 +38,7 @@ protected:
     Q_INVOKABLE QWidget * optionsWidget();
     virtual bool setParamsTP(ParameterList &) = 0;
     virtual void setBaseColumns(int);
+    virtual void fillListPivot(ParameterList &);
 
     int _column;
     QList<DatePair> _columnDates;
@@ -18,6 +18,7 @@
 #include "parameterlistsetup.h"
 
 class QToolButton;
+class XTreeWidgetPager;
 class display;
 
 class displayPrivate : public QObject, public Ui::display
@@ -36,6 +37,9 @@ class displayPrivate : public QObject, public Ui::display
     QString metasqlGroup;
 
     bool _useAltId;
+    bool _queryInBackground;
+    bool _reportingConnection;
+    bool _fillListPending;
     bool _queryOnStartEnabled;
     bool _autoUpdateEnabled;
     bool _filterChanged;
@@ -67,11 +71,16 @@ class displayPrivate : public QObject, public Ui::display
     QToolButton *_printBtn;
     QToolButton *_expandBtn;
     QToolButton *_collapseBtn;
+    QLabel      *_staleLit;
 
     QList<QVariant> _charidstext;
     QList<QVariant> _charidslist;
     QList<QVariant> _charidsdate;
 
+    QStringList _resultCacheTables;
+    QStringList _autoUpdateTables;
+    XTreeWidgetPager *_pager;
+
   public slots:
     void sFilterChanged();
 
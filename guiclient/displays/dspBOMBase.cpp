@@ -23,7 +23,7 @@ dspBOMBase::dspBOMBase(QWidget* parent, const char* name, Qt::WindowFlags fl)
   setMetaSQLOptions("bom", "detail");
 
   connect(_item, SIGNAL(valid(bool)), _revision, SLOT(setEnabled(bool)));
-  connect(omfgThis, SIGNAL(bomsUpdated(int, bool)), this, SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(bomsUpdated(int, bool)), this, SLOT(sScheduleFillList()));
 
   _item->setType(ItemLineEdit::cHasBom);
 
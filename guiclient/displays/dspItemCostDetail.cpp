@@ -42,7 +42,7 @@ dspItemCostDetail::dspItemCostDetail(QWidget* parent, const char*, Qt::WindowFla
   list()->addColumn(tr("Unit Cost"),       _costColumn,  Qt::AlignRight, true, "cost");
   list()->addColumn(tr("Ext'd Cost"),      _moneyColumn, Qt::AlignRight, true, "extendedcost");
 
-  connect(omfgThis, SIGNAL(bomsUpdated(int, bool)), SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(bomsUpdated(int, bool)), SLOT(sScheduleFillList()));
 }
 
 void dspItemCostDetail::languageChange()
@@ -46,7 +46,7 @@ dspPendingBOMChanges::dspPendingBOMChanges(QWidget* parent, const char*, Qt::Win
   list()->addColumn(tr("Qty. Per"),    _qtyColumn,   Qt::AlignRight,  true,  "qtyper"  );
   list()->addColumn(tr("Scrap %"),     _prcntColumn, Qt::AlignRight,  true,  "bomitem_scrap"  );
   
-  connect(omfgThis, SIGNAL(bomsUpdated(int, bool)), SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(bomsUpdated(int, bool)), SLOT(sScheduleFillList()));
   _revision->setMode(RevisionLineEdit::View);
   _revision->setType("BOM");
 
@@ -52,7 +52,7 @@ dspPurchaseReqsByItem::dspPurchaseReqsByItem(QWidget* parent, const char*, Qt::W
 
   newAction()->setEnabled(false);
   
-  connect(omfgThis, SIGNAL(purchaseRequestsUpdated()), this, SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(purchaseRequestsUpdated()), this, SLOT(sScheduleFillList()));
   connect(_item,    SIGNAL(valid(bool)), newAction(), SLOT(setEnabled(bool)));
 }
 
@@ -51,7 +51,7 @@ dspReturnAuthorizations::dspReturnAuthorizations(QWidget* parent, const char*, Q
   parameterWidget()->append(tr("Date From"), "dateFrom", ParameterWidget::Date);
   parameterWidget()->append(tr("Date To"), "dateTo", ParameterWidget::Date);
 
-  connect(omfgThis, SIGNAL(returnAuthorizationsUpdated(int, bool)), this, SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(returnAuthorizationsUpdated(int, bool)), this, SLOT(sScheduleFillList()));
 }
 
 enum SetResponse dspReturnAuthorizations::set(const ParameterList &pParams)
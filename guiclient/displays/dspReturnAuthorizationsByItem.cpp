@@ -41,7 +41,7 @@ dspReturnAuthorizationsByItem::dspReturnAuthorizationsByItem(QWidget* parent, co
   list()->addColumn(tr("Authorized"),      _qtyColumn,   Qt::AlignRight,  true,  "raitem_qtyauthorized"  );
   list()->addColumn(tr("Received"),        _qtyColumn,   Qt::AlignRight,  true,  "raitem_qtyreceived"  );
 
-  connect(omfgThis, SIGNAL(returnAuthorizationsUpdated(int, bool)), this, SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(returnAuthorizationsUpdated(int, bool)), this, SLOT(sScheduleFillList()));
 }
 
 void dspReturnAuthorizationsByItem::languageChange()
@@ -60,7 +60,7 @@ dspRunningAvailability::dspRunningAvailability(QWidget* parent, const char*, Qt:
   _orderMultiple->setValidator(omfgThis->qtyVal());
   _orderToQty->setValidator(omfgThis->qtyVal());
 
-  connect(omfgThis, SIGNAL(workOrdersUpdated(int, bool)), this, SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(workOrdersUpdated(int, bool)), this, SLOT(sScheduleFillList()));
 
   if (!_metrics->boolean("MultiWhs"))
   {
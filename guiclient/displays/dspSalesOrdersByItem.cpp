@@ -51,7 +51,7 @@ dspSalesOrdersByItem::dspSalesOrdersByItem(QWidget* parent, const char*, Qt::Win
   list()->addColumn(tr("Inv. Returned"),   _qtyColumn,   Qt::AlignRight,  false, "invqtyreturned"  );
   list()->addColumn(tr("Inv. Balance"),    _qtyColumn,   Qt::AlignRight,  false, "invqtybalance"  );
 
-  connect(omfgThis, SIGNAL(salesOrdersUpdated(int, bool)), this, SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(salesOrdersUpdated(int, bool)), this, SLOT(sScheduleFillList()));
 }
 
 void dspSalesOrdersByItem::languageChange()
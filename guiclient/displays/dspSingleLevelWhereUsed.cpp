@@ -48,7 +48,7 @@ dspSingleLevelWhereUsed::dspSingleLevelWhereUsed(QWidget* parent, const char*, Q
   list()->addColumn(tr("Effective"),   _dateColumn,  Qt::AlignCenter,true, "bomitem_effective");
   list()->addColumn(tr("Expires"),     _dateColumn,  Qt::AlignCenter,true, "bomitem_expires");
   
-  connect(omfgThis, SIGNAL(bomsUpdated(int, bool)), SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(bomsUpdated(int, bool)), SLOT(sScheduleFillList()));
 }
 
 void dspSingleLevelWhereUsed::languageChange()
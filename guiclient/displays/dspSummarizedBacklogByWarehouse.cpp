@@ -65,7 +65,7 @@ dspSummarizedBacklogByWarehouse::dspSummarizedBacklogByWarehouse(QWidget* parent
     _showPrices->setEnabled(false);
   sHandlePrices(_showPrices->isChecked());
 
-  connect(omfgThis, SIGNAL(salesOrdersUpdated(int, bool)), this, SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(salesOrdersUpdated(int, bool)), this, SLOT(sScheduleFillList()));
 
   sFillList();
 }
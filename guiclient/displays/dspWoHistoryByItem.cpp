@@ -45,7 +45,7 @@ dspWoHistoryByItem::dspWoHistoryByItem(QWidget* parent, const char*, Qt::WindowF
 
   sHandleCosts(_showCost->isChecked());
   
-  connect(omfgThis, SIGNAL(workOrdersUpdated(int, bool)), this, SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(workOrdersUpdated(int, bool)), this, SLOT(sScheduleFillList()));
 
 }
 
@@ -47,7 +47,7 @@ dspWoHistoryByNumber::dspWoHistoryByNumber(QWidget* parent, const char*, Qt::Win
 
   sHandleCosts(_showCost->isChecked());
 
-  connect(omfgThis, SIGNAL(workOrdersUpdated(int, bool)), SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(workOrdersUpdated(int, bool)), SLOT(sScheduleFillList()));
 }
 
 void dspWoHistoryByNumber::languageChange()
@@ -104,7 +104,7 @@ dspWoSchedule::dspWoSchedule(QWidget* parent, const char*, Qt::WindowFlags fl)
     connect(list(), SIGNAL(itemSelected(int)), this, SLOT(sView()));
   }
 
-  connect(omfgThis, SIGNAL(workOrdersUpdated(int, bool)), this, SLOT(sFillList()));
+  connect(omfgThis, SIGNAL(workOrdersUpdated(int, bool)), this, SLOT(sScheduleFillList()));
 }
 
 enum SetResponse dspWoSchedule::set(const ParameterList &pParams)
@@ -29,6 +29,7 @@
 #include "dspFinancialReport.h"
 #include "dspGLTransactions.h"
 #include "financialReportNotes.h"
+#include "parallelquery.h"
 #include "storedProcErrorLookup.h"
 #include "errorReporter.h"
 
@@ -570,6 +571,12 @@ void dspFinancialReport::sFillListTrend()
 
   dspFillListTrend.prepare("SELECT financialReport(:flhead_id, :period_id, :interval, :prjid) AS result;");
 
+  /* FinancialReportParallelism > 1 runs financialReport() for that many
+     periods at a time, each on its own database session
+   */
+  int parallelism = _metrics->value("FinancialReportParallelism").toInt();
+  ParallelQuery parallel(parallelism);
+
   QString q1c = QString("SELECT -1, r0.flrpt_order AS orderby, r0.flrpt_level AS xtindentrole,"
                         "       :group AS type, flgrp_id AS id,"
                         "       flgrp_name AS name");
@@ -796,6 +803,17 @@ void dspFinancialReport::sFillListTrend()
     if(c > 0)
       q4w += QString(" AND (r0.flrpt_order=r%1.flrpt_order)").arg(c);
 
+    if (parallelism > 1)
+    {
+      QMap<QString, QVariant> bindings;
+      bindings.insert(":flhead_id", _flhead->id());
+      bindings.insert(":period_id", periodsRef.at(c));
+      bindings.insert(":interval", interval);
+      bindings.insert(":prjid", _prjid);
+      parallel.append("SELECT financialReport(:flhead_id, :period_id, :interval, :prjid) AS result;",
+                      bindings);
+      continue;
+    }
     dspFillListTrend.bindValue(":flhead_id", _flhead->id());
     dspFillListTrend.bindValue(":period_id", periodsRef.at(c));
     dspFillListTrend.bindValue(":interval", interval);
@@ -803,6 +821,14 @@ void dspFinancialReport::sFillListTrend()
     dspFillListTrend.exec();
   }
 
+  // each period's flrpt rows are independent of the others
+  if (parallel.count() > 0 && ! parallel.exec())
+  {
+    ErrorReporter::error(QtCriticalMsg, this, tr("Error Retrieving Financial Information"),
+                         parallel.errorString(), __FILE__, __LINE__);
+    return;
+  }
+
   //Grand Total for Trend Reports
   if ((_trend->isChecked()) && ((_typeCode == "I") || (_typeCode == "C")))
   {
@@ -49,6 +49,8 @@
 #include "errorLog.h"
 #include "errorReporter.h"
 #include "login2.h"
+#include "metasqlcache.h"
+#include "virtualclustercache.h"
 #include "storedProcErrorLookup.h"
 
 #include "systemMessage.h"
@@ -426,6 +428,7 @@ GUIClient::GUIClient(const QString &pDatabaseURL, const QString &pUsername)
   XComboBox::_guiClientInterface = VirtualClusterLineEdit::_guiClientInterface;
   XTextEdit::_guiClientInterface = VirtualClusterLineEdit::_guiClientInterface;
   XTextEditHighlighter::_guiClientInterface = VirtualClusterLineEdit::_guiClientInterface;
+  connect(this, SIGNAL(dbConnectionLost()), MetaSQLCache::cache(), SLOT(clear()));
 
   _splash->showMessage(tr("Completing Initialization"), SplashTextAlignment, SplashTextColor);
   qApp->processEvents();
@@ -1099,6 +1102,7 @@ void GUIClient::sSystemMessageAdded()
   */
 void GUIClient::sItemsUpdated(int pItemid, bool pLocal)
 {
+  VirtualClusterCache::cache()->invalidate("item");
   emit itemsUpdated(pItemid, pLocal);
 }
 
@@ -1129,6 +1133,7 @@ void GUIClient::sContractsUpdated(int pContrctid, bool pLocal)
   */
 void GUIClient::sCustomersUpdated(int pCustid, bool pLocal)
 {
+  VirtualClusterCache::cache()->invalidate("custinfo");
   emit customersUpdated(pCustid, pLocal);
 }
 
@@ -1155,6 +1160,7 @@ void GUIClient::sVendorsUpdated()
 /** @brief This slot tells other open windows the definition or status of one or more Prospects has changed. */
 void GUIClient::sProspectsUpdated()
 {
+  VirtualClusterCache::cache()->invalidate("prospect");
   emit prospectsUpdated();
 }
 
@@ -1415,6 +1421,7 @@ void GUIClient::sProjectsUpdated(int prjid)
  */
 void GUIClient::sCrmAccountsUpdated(int crmacctid)
 {
+  VirtualClusterCache::cache()->invalidate("crmacct");
   emit crmAccountsUpdated(crmacctid);
 }
 
@@ -816,7 +816,10 @@ HEADERS = ../common/format.h                    \
           departments.h                         \
           dictionaries.h                        \
           display.h                             \
+          displayDiagnostics.h                  \
           displayprivate.h                      \
+          displayRefreshScheduler.h             \
+          displayResultCache.h                  \
           displayTimePhased.h                   \
           distributeInventory.h                 \
           distributeToLocation.h                \
@@ -1436,6 +1439,9 @@ SOURCES = absoluteCalendarItem.cpp              \
           departments.cpp                       \
           dictionaries.cpp                      \
           display.cpp                           \
+          displayDiagnostics.cpp                \
+          displayRefreshScheduler.cpp           \
+          displayResultCache.cpp                \
           displayTimePhased.cpp                 \
           distributeInventory.cpp               \
           distributeToLocation.cpp              \
@@ -107,12 +107,15 @@ item::item(QWidget* parent, const char* name, Qt::WindowFlags fl)
   _packWeight->setValidator(omfgThis->weightVal());
 
   _classcode->setAllowNull(true);
+  _classcode->setLazy(true);
   _classcode->setType(XComboBox::ClassCodes);
 
   _freightClass->setAllowNull(true);
+  _freightClass->setLazy(true);
   _freightClass->setType(XComboBox::FreightClasses);
 
   _prodcat->setAllowNull(true);
+  _prodcat->setLazy(true);
   _prodcat->setType(XComboBox::ProductCategories);
 
   _inventoryUOM->setType(XComboBox::UOMs);
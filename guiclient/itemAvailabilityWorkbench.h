@@ -29,6 +29,8 @@
 #include "dspSingleLevelBOM.h"
 #include "item.h"
 
+#include <QHash>
+
 #include <parameter.h>
 
 #include "ui_itemAvailabilityWorkbench.h"
@@ -66,6 +68,13 @@ protected:
   dspSingleLevelBOM *_dspSingleLevelBOM;
   item *_itemMaster;
 
+private:
+  QWidget *currentPage() const;
+  void     createPage(QWidget *page);
+  void     setPageItem(QWidget *page);
+
+  bool               _sold;
+  QHash<QWidget*, int> _pageItemId;   // item each page was last set to
 };
 
 #endif // ITEMAVAILABILITYWORKBENCH_H
@@ -20,6 +20,7 @@
 #include <mqlutil.h>
 
 #include "errorReporter.h"
+#include "metasqlcache.h"
 #include "mqledit.h"
 #include "storedProcErrorLookup.h"
 
@@ -74,6 +75,7 @@ void metasqls::sNew()
   MQLEdit *newdlg = new MQLEdit(0);
   omfgThis->handleNewWindow(newdlg, Qt::NonModal, true);
   newdlg->forceTestMode(! _privileges->check("ExecuteMetaSQL"));
+  connect(newdlg, SIGNAL(destroyed()), MetaSQLCache::cache(), SLOT(clear()));
   connect(newdlg, SIGNAL(destroyed()), this, SLOT(sFillList()));
 }
 
@@ -108,6 +110,7 @@ void metasqls::sDelete()
                                 delq, __FILE__, __LINE__))
     return;
 
+  MetaSQLCache::cache()->clear();
   sFillList();
 }
 
@@ -122,6 +125,8 @@ void metasqls::sEdit()
   newdlg->forceTestMode(! _privileges->check("ExecuteMetaSQL"));
   omfgThis->handleNewWindow(newdlg, Qt::NonModal, true);
 
+  // the editor saves on its own, so drop what it may have changed
+  connect(newdlg, SIGNAL(destroyed()), MetaSQLCache::cache(), SLOT(clear()));
   connect(newdlg, SIGNAL(destroyed()), this, SLOT(sFillList()));
 }
 
@@ -284,7 +284,9 @@ salesOrder::salesOrder(QWidget *parent, const char *name, Qt::WindowFlags fl)
 
   _fundsType->populate("SELECT fundstype_id, fundstype_name, fundstype_code FROM fundstype WHERE NOT fundstype_creditcard;");
 
+  _bankaccnt->setLazy(true);
   _bankaccnt->setType(XComboBox::ARBankAccounts);
+  _salescat->setLazy(true);
   _salescat->setType(XComboBox::SalesCategoriesActive);
 
   sHandleMore();
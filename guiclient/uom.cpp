@@ -17,6 +17,7 @@
 #include "storedProcErrorLookup.h"
 #include "uomConv.h"
 #include "errorReporter.h"
+#include "virtualclustercache.h"
 
 uom::uom(QWidget* parent, const char* name, bool modal, Qt::WindowFlags fl)
     : XDialog(parent, name, modal, fl)
@@ -159,6 +160,7 @@ void uom::sSave()
   {
     return;
   }
+  VirtualClusterCache::cache()->invalidate("uom");
   done(_uomid);
 }
 
@@ -0,0 +1,53 @@
+#
+# This file is part of the xTuple ERP: PostBooks Edition, a free and
+# open source Enterprise Resource Planning software suite,
+# Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+# It is licensed to you under the Common Public Attribution License
+# version 1.0, the full text of which (including xTuple-specific Exhibits)
+# is available at www.xtuple.com/CPAL.  By using this software, you agree
+# to be bound by its terms.
+#
+
+# Unit tests, run with "make check". The database tests connect through
+# the usual libpq environment variables and are skipped unless
+# PGDATABASE is set, e.g.
+#   PGHOST=localhost PGDATABASE=postgres PGUSER=admin make check
+
+include( ../global.pri )
+
+TARGET   = xtupletest
+TEMPLATE = app
+CONFIG  += qt warn_on testcase
+QT      += core network printsupport script scripttools sql testlib \
+           webkit webkitwidgets widgets xml
+
+isEqual(QT_MAJOR_VERSION, 5) {
+  QT     += designer uitools quick websockets webchannel serialport
+} else {
+  CONFIG += designer uitools
+}
+
+INCLUDEPATH += ../scriptapi ../common ../widgets ../widgets/tmp/lib .
+DEPENDPATH  += $${INCLUDEPATH}
+
+unix: !macx {
+  PRE_TARGETDEPS += ../lib/libxtuplecommon.$${XTLIBEXT} \
+                    ../lib/libxtuplescriptapi.a         \
+                    ../lib/libxtuplewidgets.a
+}
+
+QMAKE_LIBDIR = ../lib $${OPENRPT_LIBDIR} $$QMAKE_LIBDIR
+LIBS        += -lxtuplewidgets -lxtuplecommon -lwrtembed -lopenrptcommon
+LIBS        += -lrenderer -lxtuplescriptapi -lqzint $${DMTXLIB} -lMetaSQL -lz
+
+equals(QT_MAJOR_VERSION, 5) {
+  unix: !macx {
+    LIBS += -lQt5DesignerComponents
+  }
+}
+
+OBJECTS_DIR = tmp
+MOC_DIR     = tmp
+
+HEADERS = xtreewidgettest.h
+SOURCES = xtreewidgettest.cpp
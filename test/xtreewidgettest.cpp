@@ -0,0 +1,344 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgettest.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QtTest>
+
+#include <parameter.h>
+#include <xsqlquery.h>
+
+#include "xtreewidget.h"
+#include "xtreewidgetrunningtotal.h"
+
+// ms to wait for a fetch that should finish promptly
+#define FETCHTIMEOUT 10000
+
+// s the cancellation tests sleep on the server; long enough to tell
+// a cancelled statement from one that ran to completion
+#define SLEEPSECONDS 60
+
+#define REQUIREDB()                                             \
+  if (! _haveDb)                                                \
+    QSKIP("set PGDATABASE to run the database tests")
+
+FetchCollector::FetchCollector(XTreeWidgetFetchThread *fetch)
+  : QObject(),
+    done(false)
+{
+  connect(fetch, SIGNAL(recordReady(QSqlRecord, int)),
+          this,  SLOT(sRecordReady(QSqlRecord, int)));
+  connect(fetch, SIGNAL(rowsReady(XTreeWidgetRowBatch)),
+          this,  SLOT(sRowsReady(XTreeWidgetRowBatch)));
+  connect(fetch, SIGNAL(finished()), this, SLOT(sFinished()));
+}
+
+void FetchCollector::sRecordReady(const QSqlRecord &pRecord, int size)
+{
+  Q_UNUSED(size);
+  record = pRecord;
+}
+
+void FetchCollector::sRowsReady(const XTreeWidgetRowBatch &batch)
+{
+  batchSizes.append(batch.rowCount());
+  for (int row = 0; row < batch.rowCount(); row++)
+    ids.append(batch.value(row, 0).toInt());
+}
+
+void FetchCollector::sFinished()
+{
+  done = true;
+}
+
+/* the database tests use the libpq environment: PGHOST, PGPORT, PGUSER,
+   PGPASSWORD and PGDATABASE. without PGDATABASE they are skipped.
+ */
+void XTreeWidgetTest::initTestCase()
+{
+  _haveDb = false;
+  if (qgetenv("PGDATABASE").isEmpty())
+    return;
+
+  QSqlDatabase db = QSqlDatabase::addDatabase("QPSQL");
+  db.setDatabaseName(QString::fromLocal8Bit(qgetenv("PGDATABASE")));
+  if (! db.open())
+    QFAIL(qPrintable(db.lastError().text()));
+  _haveDb = true;
+}
+
+/* one row of the running total model below */
+struct RunningRow
+{
+  int    set;
+  double init;
+  double value;
+};
+
+/* the subtotals the way populateCalculatedColumns() used to add them
+   up, one row at a time from the top
+ */
+static QList<double> sequentialSubtotals(const QList<RunningRow> &rows)
+{
+  QHash<int, double> subtotals;
+  QList<double>      result;
+  for (int i = 0; i < rows.size(); i++)
+  {
+    if (! subtotals.contains(rows.at(i).set))
+      subtotals.insert(rows.at(i).set, rows.at(i).init);
+    subtotals[rows.at(i).set] += rows.at(i).value;
+    result.append(subtotals.value(rows.at(i).set));
+  }
+  return result;
+}
+
+/* random appends, value changes, set changes and truncate-then-append,
+   checking every subtotal after each step. values are whole numbers
+   so the sums are exact.
+ */
+void XTreeWidgetTest::runningTotalMatchesSum()
+{
+  qsrand(8);
+
+  XTreeWidgetRunningTotal running;
+  QList<RunningRow>       rows;
+  for (int step = 0; step < 2000; step++)
+  {
+    int op = qrand() % 10;
+    if (op < 5 || rows.isEmpty())
+    {
+      RunningRow row = { qrand() % 4, double(qrand() % 100), double(qrand() % 201 - 100) };
+      QCOMPARE(running.append(row.set, row.init, row.value), rows.size());
+      rows.append(row);
+    }
+    else if (op < 7)
+    {
+      int    row   = qrand() % rows.size();
+      double value = double(qrand() % 201 - 100);
+      running.setRawValue(row, value);
+      rows[row].value = value;
+    }
+    else
+    {
+      // change a row, possibly its set, then append it and the rows after
+      // it again the way XTreeWidget does after a change or a move
+      int row = qrand() % rows.size();
+      if (op == 9)
+        rows[row].set = qrand() % 4;
+      running.truncate(row);
+      QCOMPARE(running.rowCount(), row);
+      for (int i = row; i < rows.size(); i++)
+        running.append(rows.at(i).set, rows.at(i).init, rows.at(i).value);
+    }
+
+    QCOMPARE(running.rowCount(), rows.size());
+    QList<double> expected = sequentialSubtotals(rows);
+    for (int row = 0; row < rows.size(); row++)
+    {
+      QCOMPARE(running.rawValue(row), rows.at(row).value);
+      QCOMPARE(running.value(row), expected.at(row));
+    }
+  }
+
+  running.truncate(0);
+  QCOMPARE(running.rowCount(), 0);
+  QCOMPARE(running.append(5, 3.0, 4.0), 0);
+  QCOMPARE(running.value(0), 7.0);
+}
+
+/* change a row in the middle of a list with a running column in place:
+   it and every row after it have to show the new subtotal, and its
+   xthiddenrole has to reach the item already in the tree
+ */
+void XTreeWidgetTest::applyChangesUpdatesRunningTotals()
+{
+  REQUIREDB();
+
+  XTreeWidget list;
+  list.setPopulateLinear(true);
+  list.addColumn("Id",     -1, Qt::AlignRight, true, "id");
+  list.addColumn("Amount", -1, Qt::AlignRight, true, "amount");
+
+  XSqlQuery rows;
+  QVERIFY(rows.exec("SELECT id, id * 10 AS amount, 0 AS amount_xtrunningrole,"
+                    "       false AS xthiddenrole"
+                    "  FROM generate_series(1, 10) AS id"
+                    " ORDER BY id;"));
+  list.populate(rows);
+  QCOMPARE(list.topLevelItemCount(), 10);
+
+  XSqlQuery change;
+  QVERIFY(change.exec("SELECT 5 AS id, 1000 AS amount, 0 AS amount_xtrunningrole,"
+                      "       true AS xthiddenrole;"));
+  QVERIFY(list.applyChanges(change, QList<int>()));
+  QCOMPARE(list.topLevelItemCount(), 10);
+
+  double subtotal = 0.0;
+  for (int row = 0; row < list.topLevelItemCount(); row++)
+  {
+    XTreeWidgetItem *item = list.topLevelItem(row);
+    subtotal += item->data(1, Xt::RawRole).toDouble();
+    QCOMPARE(item->text(1),
+             QLocale().toString(subtotal, 'f', item->data(1, Xt::ScaleRole).toInt()));
+    QCOMPARE(item->isHidden(), item->id() == 5);
+  }
+  QCOMPARE(subtotal, 1500.0);
+}
+
+void XTreeWidgetTest::fetchDeliversEveryRow()
+{
+  REQUIREDB();
+
+  ParameterList params;
+  params.append("rows", 1234);
+  XTreeWidgetFetchThread fetch("SELECT id FROM generate_series(1, <? value('rows') ?>) AS id"
+                               " ORDER BY id;",
+                               params, QMap<QString, QVariant>());
+  FetchCollector collector(&fetch);
+  fetch.start();
+
+  QTRY_VERIFY_WITH_TIMEOUT(collector.done, FETCHTIMEOUT);
+  fetch.wait();
+  QVERIFY2(fetch.errorString().isEmpty(), qPrintable(fetch.errorString()));
+  QCOMPARE(collector.record.count(), 1);
+  QCOMPARE(collector.record.fieldName(0), QString("id"));
+  QCOMPARE(collector.batchSizes, QList<int>() << 500 << 500 << 234);
+  QCOMPARE(collector.ids.size(), 1234);
+  for (int i = 0; i < collector.ids.size(); i++)
+    QCOMPARE(collector.ids.at(i), i + 1);
+}
+
+void XTreeWidgetTest::fetchAttachesBatches()
+{
+  REQUIREDB();
+
+  XTreeWidget list;
+  list.addColumn("Id",    -1, Qt::AlignRight, true, "id");
+  list.addColumn("Value", -1, Qt::AlignRight, true, "value");
+  QSignalSpy populated(&list, SIGNAL(populated()));
+
+  ParameterList params;
+  list.populateAsync("SELECT id, id * 10 AS value"
+                     "  FROM generate_series(1, 1234) AS id"
+                     " ORDER BY id;", params);
+  QVERIFY(list.isFetching());
+
+  QTRY_COMPARE_WITH_TIMEOUT(populated.count(), 1, FETCHTIMEOUT);
+  QVERIFY(! list.isFetching());
+  QCOMPARE(list.topLevelItemCount(), 1234);
+  for (int row = 0; row < list.topLevelItemCount(); row++)
+  {
+    XTreeWidgetItem *item = list.topLevelItem(row);
+    QCOMPARE(item->id(), row + 1);
+    QCOMPARE(item->rawValue("value").toInt(), (row + 1) * 10);
+  }
+}
+
+void XTreeWidgetTest::fetchCancel()
+{
+  REQUIREDB();
+
+  // the thread itself: no rows after cancel() except batches already queued
+  ParameterList params;
+  XTreeWidgetFetchThread fetch("SELECT id FROM generate_series(1, 1000000) AS id;",
+                               params, QMap<QString, QVariant>());
+  FetchCollector collector(&fetch);
+  fetch.start();
+  QTRY_VERIFY_WITH_TIMEOUT(! collector.batchSizes.isEmpty(), FETCHTIMEOUT);
+  fetch.cancel();
+  QVERIFY(fetch.isCancelled());
+  QTRY_VERIFY_WITH_TIMEOUT(collector.done, FETCHTIMEOUT);
+  fetch.wait();
+  QVERIFY(collector.ids.size() < 1000000);
+
+  // the list: stopping keeps the rows already attached and never finishes
+  XTreeWidget list;
+  list.addColumn("Id", -1, Qt::AlignRight, true, "id");
+  QSignalSpy populated(&list, SIGNAL(populated()));
+  list.populateAsync("SELECT id FROM generate_series(1, 1000000) AS id;", params);
+  QTRY_VERIFY_WITH_TIMEOUT(list.topLevelItemCount() > 0, FETCHTIMEOUT);
+  list.sCancelFetch();
+  QVERIFY(! list.isFetching());
+
+  int rows = list.topLevelItemCount();
+  QTest::qWait(500);
+  QCOMPARE(list.topLevelItemCount(), rows);
+  QCOMPARE(populated.count(), 0);
+}
+
+/* wait until another session is executing the pg_sleep() statement */
+bool XTreeWidgetTest::waitForSleep()
+{
+  QSqlQuery     active;
+  QElapsedTimer timer;
+  timer.start();
+  while (timer.elapsed() < FETCHTIMEOUT)
+  {
+    if (active.exec("SELECT COUNT(*) AS count FROM pg_stat_activity"
+                    " WHERE state = 'active'"
+                    "   AND query LIKE 'SELECT pg_sleep(%'"
+                    "   AND pid != pg_backend_pid();") &&
+        active.first() && active.value("count").toInt() > 0)
+      return true;
+    QTest::qWait(50);
+  }
+  return false;
+}
+
+/* pg_cancel_backend() has to stop a statement that is still executing,
+   well before it would end on its own or the cancel times out and
+   ends the session
+ */
+void XTreeWidgetTest::cancelStopsRunningStatement()
+{
+  REQUIREDB();
+
+  ParameterList params;
+  XTreeWidgetFetchThread fetch(QString("SELECT pg_sleep(%1) AS id;").arg(SLEEPSECONDS),
+                               params, QMap<QString, QVariant>());
+  FetchCollector collector(&fetch);
+  fetch.start();
+  QVERIFY(waitForSleep());
+
+  QElapsedTimer timer;
+  timer.start();
+  fetch.cancel();
+  QTRY_VERIFY_WITH_TIMEOUT(collector.done, 4000);
+  fetch.wait();
+  QVERIFY(timer.elapsed() < 4000);
+  QVERIFY(collector.ids.isEmpty());
+  QVERIFY(! fetch.errorString().isEmpty());
+}
+
+void XTreeWidgetTest::terminateEndsSession()
+{
+  REQUIREDB();
+
+  ParameterList params;
+  XTreeWidgetFetchThread fetch(QString("SELECT pg_sleep(%1) AS id;").arg(SLEEPSECONDS),
+                               params, QMap<QString, QVariant>());
+  FetchCollector collector(&fetch);
+  fetch.start();
+  QVERIFY(waitForSleep());
+
+  fetch.terminateBackend();
+  QTRY_VERIFY_WITH_TIMEOUT(collector.done, FETCHTIMEOUT);
+  fetch.wait();
+  QVERIFY(collector.ids.isEmpty());
+  QVERIFY(! fetch.errorString().isEmpty());
+}
+
+QTEST_MAIN(XTreeWidgetTest)
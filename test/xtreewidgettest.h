@@ -0,0 +1,61 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETTEST_H
+#define XTREEWIDGETTEST_H
+
+#include <QList>
+#include <QObject>
+#include <QSqlRecord>
+
+#include "xtreewidgetfetcher.h"
+
+/* records what an XTreeWidgetFetchThread hands to the GUI thread */
+class FetchCollector : public QObject
+{
+  Q_OBJECT
+
+  public:
+    FetchCollector(XTreeWidgetFetchThread *fetch);
+
+    QSqlRecord  record;
+    QList<int>  batchSizes;
+    QList<int>  ids;
+    bool        done;
+
+  public slots:
+    void sRecordReady(const QSqlRecord &record, int size);
+    void sRowsReady(const XTreeWidgetRowBatch &batch);
+    void sFinished();
+};
+
+class XTreeWidgetTest : public QObject
+{
+  Q_OBJECT
+
+  private slots:
+    void initTestCase();
+
+    void runningTotalMatchesSum();
+    void applyChangesUpdatesRunningTotals();
+
+    void fetchDeliversEveryRow();
+    void fetchAttachesBatches();
+    void fetchCancel();
+    void cancelStopsRunningStatement();
+    void terminateEndsSession();
+
+  private:
+    bool waitForSleep();
+
+    bool _haveDb;
+};
+
+#endif
@@ -38,6 +38,7 @@ CLineEdit::CLineEdit(QWidget *pParent, const char *pName) :
   _editMode = false;
 
   setTitles(tr("Customer"), tr("Customers"));
+  _cacheNotification = "custinfo prospect crmacct cntct addr";
 
   _query = "SELECT cust.*,"
            "       addr_line1 AS description,"
@@ -64,6 +64,7 @@ GLClusterLineEdit::GLClusterLineEdit(QWidget* pParent, const char* pName) :
   setEditPriv("MaintainChartOfAccounts");
   setViewPriv("ViewChartOfAccounts");
   setNewPriv("MaintainChartOfAccounts");
+  _cacheNotification = "accnt company";
 
   _showExternal = false;
   _ignoreCompany = false;
@@ -22,9 +22,11 @@
 
 #include <xsqlquery.h>
 
+#include "errorReporter.h"
 #include "guiclientinterface.h"
 #include "itemcluster.h"
 #include "itemAliasList.h"
+#include "virtualclustercache.h"
 #include "xcheckbox.h"
 #include "xtreewidget.h"
 #include "xsqltablemodel.h"
@@ -34,6 +36,32 @@
 QString buildItemLineEditQuery(const QString, const QStringList, const QString, const unsigned int, bool);
 QString buildItemLineEditTitle(const unsigned int, const QString);
 
+static QString itemLookupColumns("SELECT DISTINCT item_number, item_descrip1, item_descrip2,"
+                                 "                uom_name, item_type, item_config, item_fractional, item_upccode,"
+                                 "                item_sold, item_active");
+
+/* the ItemLineEdit::Type bit buildItemLineEditQuery() tests for an item_type */
+static unsigned int itemTypeBit(const QString &code)
+{
+  static QHash<QString, unsigned int> bits;
+  if (bits.isEmpty())
+  {
+    bits.insert("P", ItemLineEdit::cPurchased);
+    bits.insert("M", ItemLineEdit::cManufactured);
+    bits.insert("F", ItemLineEdit::cPhantom);
+    bits.insert("B", ItemLineEdit::cBreeder);
+    bits.insert("C", ItemLineEdit::cCoProduct);
+    bits.insert("Y", ItemLineEdit::cByProduct);
+    bits.insert("R", ItemLineEdit::cReference);
+    bits.insert("S", ItemLineEdit::cCosting);
+    bits.insert("T", ItemLineEdit::cTooling);
+    bits.insert("O", ItemLineEdit::cOutsideProcess);
+    bits.insert("L", ItemLineEdit::cPlanning);
+    bits.insert("K", ItemLineEdit::cKit);
+  }
+  return bits.value(code, 0);
+}
+
 QString buildItemLineEditQuery(const QString pPre, const QStringList pClauses, const QString pPost, const unsigned int pType, bool unionAlias)
 {
   QStringList clauses = pClauses;
@@ -270,6 +298,7 @@ ItemLineEdit::ItemLineEdit(QWidget* pParent, const char* pName) :
   setEditPriv("MaintainItemMasters");
   setViewPriv("ViewItemMasters");
   setNewPriv("MaintainItemMasters");
+  _cacheNotification = "item uom";
 
   setAcceptDrops(true);
   
@@ -327,7 +356,8 @@ void ItemLineEdit::setItemNumber(const QString& pNumber)
     else if (pNumber != QString::Null())
     {
       QString pre( "SELECT DISTINCT item_id, item_number, item_descrip1, item_descrip2,"
-                   "                uom_name, item_type, item_config, item_fractional, item_upccode");
+                   "                uom_name, item_type, item_config, item_fractional, item_upccode,"
+                   "                item_sold, item_active");
 
       QStringList clauses;
       clauses = _extraClauses;
@@ -360,6 +390,7 @@ void ItemLineEdit::setItemNumber(const QString& pNumber)
     _id         = item.value("item_id").toInt();
     _upc        = item.value("item_upccode").toInt();
     _valid      = true;
+    _record     = item.record();
 
     setText(item.value("item_number").toString());
 
@@ -381,6 +412,7 @@ void ItemLineEdit::setItemNumber(const QString& pNumber)
     _itemType   = "";
     _id         = -1;
     _valid      = false;
+    _record     = QSqlRecord();
     _upc        = "";
 
     setText("");
@@ -404,8 +436,9 @@ void ItemLineEdit::silentSetId(const int pId)
     qDebug("%s::silentSetId(%d) entered",
            qPrintable(objectName()), pId);
 
-  XSqlQuery item;
-  bool      found = false;
+  XSqlQuery  item;
+  QSqlRecord values;
+  bool       found = false;
 
   _parsed = true;
 
@@ -425,46 +458,58 @@ void ItemLineEdit::silentSetId(const int pId)
   }
   else if (pId != -1)
   {
-    QString pre( "SELECT DISTINCT item_number, item_descrip1, item_descrip2,"
-                 "                uom_name, item_type, item_config, item_fractional, item_upccode");
-
     QStringList clauses;
     clauses = _extraClauses;
     clauses << "(item_id=:item_id)";
 
-    item.prepare(buildItemLineEditQuery(pre, clauses, QString::null, _type, false));
-    item.bindValue(":item_id", pId);
-    item.exec();
+    QString sql = buildItemLineEditQuery(itemLookupColumns, clauses, QString::null, _type, false);
+    found = VirtualClusterCache::cache()->find(sql, pId, values);
+    if (! found)
+    {
+      item.prepare(sql);
+      item.bindValue(":item_id", pId);
+      item.exec();
 
-    found = item.first();
+      found = item.first();
+      if (found)
+        VirtualClusterCache::cache()->insert(sql, _cacheNotification, pId, item.record());
+    }
   }
 
-  if (found)
+  if (found && values.isEmpty())
+    values = item.record();
+
+  showRecord(found ? pId : -1, found ? values : QSqlRecord());
+}
+
+/* show the item in values, or no item if pId is -1 */
+void ItemLineEdit::showRecord(int pId, const QSqlRecord &values)
+{
+  if (pId != -1)
   {
     if (completer())
-    {
       disconnect(this, SIGNAL(textChanged(QString)), this, SLOT(sHandleCompleter()));
-      static_cast<QSqlQueryModel* >(completer()->model())->setQuery(QSqlQuery());
-    }
-
-    _itemNumber = item.value("item_number").toString();
-    _uom        = item.value("uom_name").toString();
-    _itemType   = item.value("item_type").toString();
-    _configured = item.value("item_config").toBool();
-    _fractional = item.value("item_fractional").toBool();
-    _upc        = item.value("item_upccode").toString();
+    clearCompleter();
+
+    _itemNumber = values.value("item_number").toString();
+    _uom        = values.value("uom_name").toString();
+    _itemType   = values.value("item_type").toString();
+    _configured = values.value("item_config").toBool();
+    _fractional = values.value("item_fractional").toBool();
+    _upc        = values.value("item_upccode").toString();
     _id         = pId;
     _valid      = true;
+    _record     = values;
 
-    setText(item.value("item_number").toString());
+    setText(values.value("item_number").toString());
     emit aliasChanged("");
     emit typeChanged(_itemType);
-    emit descrip1Changed(item.value("item_descrip1").toString());
-    emit descrip2Changed(item.value("item_descrip2").toString());
-    emit uomChanged(item.value("uom_name").toString());
-    emit configured(item.value("item_config").toBool());
-    emit fractional(item.value("item_fractional").toBool());
-    emit upcChanged(item.value("item_upccode").toString());
+    emit descrip1Changed(values.value("item_descrip1").toString());
+    emit descrip2Changed(values.value("item_descrip2").toString());
+    emit uomChanged(values.value("uom_name").toString());
+    emit configured(values.value("item_config").toBool());
+    emit fractional(values.value("item_fractional").toBool());
+    emit upcChanged(values.value("item_upccode").toString());
     
     emit valid(true);
 
@@ -479,6 +524,7 @@ void ItemLineEdit::silentSetId(const int pId)
     _id         = -1;
     _upc        = "";
     _valid      = false;
+    _record     = QSqlRecord();
 
     setText("");
 
@@ -495,6 +541,97 @@ void ItemLineEdit::silentSetId(const int pId)
   }
 } 
 
+/*! Show item \a pId from \a values, a record another ItemLineEdit
+    returned from record(). The database is only asked again if this
+    line edit's own filters can't be checked against \a values.
+ */
+void ItemLineEdit::setId(int pId, const QSqlRecord &values)
+{
+  if (pId == -1 || ! canShow(values))
+  {
+    setId(pId);
+    return;
+  }
+
+  bool changed = (pId != _id);
+  _parsed = true;
+  showRecord(pId, values);
+  if (changed)
+  {
+    emit privateIdChanged(_id);
+    emit newId(_id);
+  }
+}
+
+/* whether silentSetId() would find the item in values. only the
+   filters that depend on columns of values can be checked.
+ */
+bool ItemLineEdit::canShow(const QSqlRecord &values) const
+{
+  const unsigned int checkable = cAllItemTypes_Mask | cSold | cItemActive;
+  if (_useQuery || _useValidationQuery || ! _extraClauses.isEmpty() ||
+      (_type & ~checkable) || ! values.contains("item_number") ||
+      ! values.contains("item_type") || ! values.contains("item_sold") ||
+      ! values.contains("item_active"))
+    return false;
+
+  if ((_type & cAllItemTypes_Mask) &&
+      ! (_type & itemTypeBit(values.value("item_type").toString())))
+    return false;
+  if ((_type & cSold) && ! values.value("item_sold").toBool())
+    return false;
+  if ((_type & cItemActive) && ! values.value("item_active").toBool())
+    return false;
+
+  return true;
+}
+
+int ItemLineEdit::prefetch(const QList<int> &ids)
+{
+  if (_useValidationQuery || _useQuery || _cacheNotification.isEmpty())
+    return 0;
+
+  QStringList clauses;
+  clauses = _extraClauses;
+  clauses << "(item_id=:item_id)";
+  QString sql = buildItemLineEditQuery(itemLookupColumns, clauses, QString::null, _type, false);
+
+  QStringList missing;
+  QSqlRecord  record;
+  int         found = 0;
+  foreach (int id, ids)
+  {
+    if (id < 0)
+      continue;
+    else if (VirtualClusterCache::cache()->find(sql, id, record))
+      found++;
+    else
+      missing << QString::number(id);
+  }
+  if (missing.isEmpty())
+    return found;
+
+  clauses = _extraClauses;
+  clauses << "(item_id=ANY(CAST(:item_ids AS INTEGER[])))";
+
+  XSqlQuery item;
+  item.prepare(buildItemLineEditQuery(itemLookupColumns + ", item_id", clauses,
+                                      QString::null, _type, false));
+  item.bindValue(":item_ids", "{" + missing.join(",") + "}");
+  item.exec();
+  while (item.next())
+  {
+    VirtualClusterCache::cache()->insert(sql, _cacheNotification,
+                                         item.value("item_id").toInt(), item.record());
+    found++;
+  }
+  if (ErrorReporter::error(QtCriticalMsg, this, tr("Error looking up Items"),
+                           item, __FILE__, __LINE__))
+    return -1;
+
+  return found;
+}
+
 void ItemLineEdit::setId(int pId)
 {
   if (DEBUG) qDebug("%s::setId(%d) entered", qPrintable(objectName()), pId);
@@ -560,77 +697,35 @@ void ItemLineEdit::sCopy()
   return;
 }
 
-void ItemLineEdit::sHandleCompleter()
+QString ItemLineEdit::completerQuery(const QString &prefix, int limit,
+                                     QMap<QString, QVariant> &bindings) const
 {
-  if (DEBUG) qDebug("%s::sHandleCompleter() entered", qPrintable(objectName()));
-  if (!hasFocus())
-    return;
-
-  QString stripped = text().trimmed().toUpper();
-  if (stripped.isEmpty())
-    return;
-
-  int width = 0;
-  QSqlQueryModel* model = static_cast<QSqlQueryModel *>(_completer->model());
-  QTreeView * view = static_cast<QTreeView *>(_completer->popup());
-  _parsed = true;
-  XSqlQuery numQ;
-
   if (_useQuery)
   {
-    numQ.prepare(QString("SELECT *"
-                         "  FROM (%1) data"
-                         " WHERE (POSITION(:number IN item_number)=1)"
-                         " LIMIT 10")
-                 .arg(QString(_sql)).remove(";"));
-    numQ.bindValue(":number", stripped);
-  }
-  else
-  {
-    QString pre( "SELECT DISTINCT item_id, item_number, "
-                 "(item_descrip1 || ' ' || item_descrip2) AS itemdescrip, "
-                 "item_upccode AS description " );
-
-    QStringList clauses;
-    clauses = _extraClauses;
-    clauses << "((POSITION(:searchString IN item_number) = 1)"
-            " OR (POSITION(:searchString IN item_upccode) = 1))";
-    numQ.prepare(buildItemLineEditQuery(pre, clauses, QString::null, _type, true)
-                              .replace(";"," ORDER BY item_number LIMIT 10;"));
-    numQ.bindValue(":searchString", QString(text().trimmed().toUpper()));
-  }
-
-  numQ.exec();
-  if (numQ.first())
-  {
-    int numberCol = numQ.record().indexOf("item_number");
-    int descripCol = numQ.record().indexOf("itemdescrip");
-    model->setQuery(numQ);
-    _completer->setCompletionPrefix(stripped);
-    for (int i = 0; i < model->columnCount(); i++)
-    {
-      if ( (i == numberCol) ||
-           (i == descripCol) )
-      {
-        view->resizeColumnToContents(i);
-        width += view->columnWidth(i);
-      }
-      else
-        view->hideColumn(i);
-    }
+    bindings.insert(":number", prefix);
+    return QString("SELECT *"
+                   "  FROM (%1) data"
+                   " WHERE (POSITION(:number IN item_number)=1)"
+                   " LIMIT %2")
+           .arg(QString(_sql).remove(";")).arg(limit);
   }
-  else
-    model->setQuery(QSqlQuery());
 
-  if (width > 350)
-    width = 350;
+  QString pre( "SELECT DISTINCT item_id, item_number, "
+               "(item_descrip1 || ' ' || item_descrip2) AS itemdescrip, "
+               "item_upccode AS description " );
+
+  QStringList clauses;
+  clauses = _extraClauses;
+  clauses << "((POSITION(:searchString IN item_number) = 1)"
+          " OR (POSITION(:searchString IN item_upccode) = 1))";
+  bindings.insert(":searchString", prefix);
+  return buildItemLineEditQuery(pre, clauses, QString::null, _type, true)
+           .replace(";", QString(" ORDER BY item_number LIMIT %1;").arg(limit));
+}
 
-  QRect rect;
-  rect.setHeight(height());
-  rect.setWidth(width);
-  rect.setBottomLeft(QPoint(0, height() - 2));
-  _completer->complete(rect);
-  _parsed = false;
+QStringList ItemLineEdit::completerColumns() const
+{
+  return QStringList() << "item_number" << "itemdescrip";
 }
 
 void ItemLineEdit::sUpdateMenu()
@@ -1010,6 +1105,11 @@ void ItemCluster::setId(const int pId, const QString&)
   _number->setId(pId);
 }
 
+void ItemCluster::setId(const int pId, const QSqlRecord &values)
+{
+  static_cast<ItemLineEdit*>(_number)->setId(pId, values);
+}
+
 void ItemCluster::setItemNumber(QString pNumber)
 {
   static_cast<ItemLineEdit* >(_number)->setItemNumber(pNumber);
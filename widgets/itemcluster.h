@@ -16,6 +16,7 @@
 #include <parameter.h>
 
 #include <QItemDelegate>
+#include <QSqlRecord>
 #include <QStyleOptionViewItem>
 
 #include "virtualCluster.h"
@@ -160,8 +161,11 @@ friend class ItemLineEditDelegate;
     Q_INVOKABLE bool    isConfigured();
     Q_INVOKABLE bool    isFractional();
 
+    int prefetch(const QList<int> &ids);
+    QSqlRecord record() const { return _record; }
+    void       setId(int pId, const QSqlRecord &values);
+
   public slots:
-    void sHandleCompleter();
     void sInfo();
     void sCopy();
     void sList();
@@ -195,10 +199,18 @@ friend class ItemLineEditDelegate;
     itemSearch* searchFactory();
     void sUpdateMenu();
 
+  protected:
+    QString     completerQuery(const QString &prefix, int limit,
+                               QMap<QString, QVariant> &bindings) const;
+    QStringList completerColumns() const;
+
   private:
     void constructor();
+    bool canShow(const QSqlRecord &values) const;
+    void showRecord(int pId, const QSqlRecord &values);
 
     ItemLineEditDelegate *_delegate;
+    QSqlRecord _record;   // what silentSetId() found
     QString _sql;
     QString _validationSql;
     QString _itemNumber;
@@ -262,6 +274,8 @@ class XTUPLEWIDGETS_EXPORT ItemCluster : public VirtualCluster
     Q_INVOKABLE inline QStringList getExtraClauseList() const       { return static_cast<ItemLineEdit*>(_number)->getExtraClauseList(); }
     Q_INVOKABLE inline void clearExtraClauseList()                  { static_cast<ItemLineEdit*>(_number)->clearExtraClauseList();      }
     Q_INVOKABLE ItemLineEdit *itemLineEdit() { return static_cast<ItemLineEdit*>(_number); }
+    QSqlRecord record() const { return static_cast<ItemLineEdit*>(_number)->record(); }
+    void       setId(const int pId, const QSqlRecord &values);
 
     void setOrientation(Qt::Orientation orientation);
 
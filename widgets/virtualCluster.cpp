@@ -21,11 +21,15 @@
 #include <QPushButton>
 #include <QSqlQueryModel>
 #include <QSqlRecord>
+#include <QStandardItemModel>
+#include <QTimer>
 #include <QVBoxLayout>
 
 #include "errorReporter.h"
 #include "guiclientinterface.h"
 #include "shortcuts.h"
+#include "virtualclustercache.h"
+#include "virtualclustercompleter.h"
 #include "xcheckbox.h"
 #include "xdatawidgetmapper.h"
 #include "xsqlquery.h"
@@ -35,6 +39,9 @@
 
 #define DEBUG false
 
+#define COMPLETERDELAY  250     // ms to wait for more typing before querying
+#define COMPLETERLIMIT  10
+
 void VirtualCluster::init()
 {
   _number = 0;
@@ -319,6 +326,9 @@ VirtualClusterLineEdit::VirtualClusterLineEdit(QWidget* pParent,
     _completer = 0;
     _showInactive = false;
     _completerId = 0;
+    _completerSequence = 0;
+    _completerTimer = 0;
+    _completerTruncated = false;
 
     setTableAndColumnNames(pTabName, pIdColumn, pNumberColumn, pNameColumn, pDescripColumn, pActiveColumn);
 
@@ -336,7 +346,7 @@ VirtualClusterLineEdit::VirtualClusterLineEdit(QWidget* pParent,
     {
       if (!_x_metrics->boolean("DisableAutoComplete"))
       {
-        QSqlQueryModel* hints = new QSqlQueryModel(this);
+        QStandardItemModel* hints = new QStandardItemModel(this);
         hints->setObjectName("hints");
 
         _completer = new QCompleter(hints,this);
@@ -353,6 +363,11 @@ VirtualClusterLineEdit::VirtualClusterLineEdit(QWidget* pParent,
         _completer->setPopup(view);
         _completer->setCaseSensitivity(Qt::CaseInsensitive);
         _completer->setCompletionColumn(1);
+
+        _completerTimer = new QTimer(this);
+        _completerTimer->setSingleShot(true);
+        connect(_completerTimer, SIGNAL(timeout()), this, SLOT(sCompleterFetch()));
+
         connect(this, SIGNAL(textEdited(QString)), this, SLOT(sHandleCompleter()));
         connect(_completer, SIGNAL(activated(const QModelIndex &)), this, SLOT(completerHighlighted(const QModelIndex &)));
       }
@@ -429,6 +444,12 @@ VirtualClusterLineEdit::VirtualClusterLineEdit(QWidget* pParent,
     connect(menu, SIGNAL(aboutToShow()), this, SLOT(sUpdateMenu()));
   }
 
+VirtualClusterLineEdit::~VirtualClusterLineEdit()
+{
+  if (_completerSequence)
+    VirtualClusterCompleterThread::worker()->forget(this);
+}
+
 bool VirtualClusterLineEdit::eventFilter(QObject *obj, QEvent *event)
 {
     if (!_menu || obj != _menuLabel)
@@ -545,67 +566,171 @@ void VirtualClusterLineEdit::setMenu(QMenu *menu)
   _menu = menu;
 }
 
+/* Typing restarts a short timer and the lookup runs on a worker thread
+   when it expires, so keystrokes never wait on the database. The result
+   of a lookup superseded by a newer one is dropped. Text that only
+   extends the prefix of a complete earlier result is filtered from the
+   rows already in the completer without asking the database again.
+ */
 void VirtualClusterLineEdit::sHandleCompleter()
 {
-  if (!hasFocus())
+  if (!hasFocus() || !_completer)
     return;
 
   QString stripped = text().trimmed().toUpper();
   if (stripped.isEmpty())
+  {
+    _completerTimer->stop();
     return;
+  }
 
-  int width = 0;
-  QSqlQueryModel* model = static_cast<QSqlQueryModel *>(_completer->model());
-  QTreeView * view = static_cast<QTreeView *>(_completer->popup());
-  _parsed = true;
-  XSqlQuery numQ;
-  numQ.prepare(_query + _numClause +
-               (_extraClause.isEmpty() || !_strict ? "" : " AND " + _extraClause) +
-               ((_hasActive && ! _showInactive) ? _activeClause : "") +
-               QString(" ORDER BY %1 %2 LIMIT 10;")
-                       .arg(QString(_hasActive ? "active DESC," : ""), _numColName));
-  numQ.bindValue(":number", "^" + stripped);
-  numQ.exec();
-  if (numQ.first())
+  if (! _completerPrefix.isEmpty() && ! _completerTruncated &&
+      stripped.startsWith(_completerPrefix))
   {
-    int numberCol = numQ.record().indexOf("number");
-    int nameCol = numQ.record().indexOf("name");
-    int descripCol = numQ.record().indexOf("description");
-    int activeDCol = numQ.record().indexOf("active_qtdisplayrole");
-    model->setQuery(numQ);
-    _completer->setCompletionPrefix(stripped);
-
-    for (int i = 0; i < model->columnCount(); i++)
+    _completerTimer->stop();
+    if (_completerSequence)
     {
-      if ( (i != numberCol) &&
-           (!_hasName || i != nameCol ) &&
-           (!_hasDescription || i != descripCol) &&
-           (! _hasActive     || i != activeDCol))
-      {
-        view->hideColumn(i);
-      }
+      VirtualClusterCompleterThread::worker()->forget(this);
+      _completerSequence = 0;
     }
+    showCompleter(stripped);
+    return;
+  }
 
-    view->resizeColumnToContents(numberCol);
-    width += view->columnWidth(numberCol);
-    if (_hasName)
-    {
-      view->resizeColumnToContents(nameCol);
-      width += view->columnWidth(nameCol);
-    }
-    if (_hasDescription)
+  int delay = COMPLETERDELAY;
+  if (_x_preferences && ! _x_preferences->value("CompleterDelay").isEmpty())
+    delay = _x_preferences->value("CompleterDelay").toInt();
+  _completerTimer->start(qMax(0, delay));
+}
+
+void VirtualClusterLineEdit::sCompleterFetch()
+{
+  if (!hasFocus() || !_completer)
+    return;
+
+  QString stripped = text().trimmed().toUpper();
+  if (stripped.isEmpty())
+    return;
+
+  // one row more than is shown tells whether the result was cut short
+  QMap<QString, QVariant> bindings;
+  QString sql = completerQuery(stripped, COMPLETERLIMIT + 1, bindings);
+
+  VirtualClusterCompleterThread *worker = VirtualClusterCompleterThread::worker();
+  connect(worker, SIGNAL(resultReady(int, const QSqlRecord&, const XTreeWidgetRowBatch&, const QString&)),
+          this,   SLOT(sCompleterResult(int, const QSqlRecord&, const XTreeWidgetRowBatch&, const QString&)),
+          Qt::UniqueConnection);
+
+  _completerFetchPrefix = stripped;
+  _completerSequence    = worker->request(this, sql, bindings);
+}
+
+void VirtualClusterLineEdit::sCompleterResult(int sequence, const QSqlRecord &record,
+                                              const XTreeWidgetRowBatch &rows,
+                                              const QString &errorString)
+{
+  if (sequence != _completerSequence)
+    return;             // someone else's, or superseded
+  _completerSequence = 0;
+
+  if (! errorString.isEmpty())
+  {
+    if (DEBUG)
+      qDebug() << objectName() << "::sCompleterResult() error" << errorString;
+    return;
+  }
+
+  QStandardItemModel *model = static_cast<QStandardItemModel *>(_completer->model());
+  model->clear();
+  model->setColumnCount(record.count());
+  _completerRecord    = record;
+  _completerTruncated = rows.rowCount() > COMPLETERLIMIT;
+  _completerPrefix    = _completerFetchPrefix;
+
+  for (int row = 0; row < rows.rowCount() && row < COMPLETERLIMIT; row++)
+  {
+    QList<QStandardItem*> items;
+    for (int field = 0; field < rows.fieldCount(); field++)
     {
-      view->resizeColumnToContents(descripCol);
-      width += view->columnWidth(descripCol);
+      QStandardItem *item = new QStandardItem;
+      item->setData(rows.value(row, field), Qt::DisplayRole);
+      items << item;
     }
-    if (_hasActive)
+    model->appendRow(items);
+  }
+
+  QString stripped = text().trimmed().toUpper();
+  if (hasFocus() && stripped.startsWith(_completerPrefix))
+    showCompleter(stripped);
+}
+
+/*! The query behind the completer's suggestions for \a prefix, returning
+    at most \a limit rows. Put values for its placeholders in \a bindings.
+ */
+QString VirtualClusterLineEdit::completerQuery(const QString &prefix, int limit,
+                                               QMap<QString, QVariant> &bindings) const
+{
+  bindings.insert(":number", "^" + prefix);
+  return _query + _numClause +
+         (_extraClause.isEmpty() || !_strict ? "" : " AND " + _extraClause) +
+         ((_hasActive && ! _showInactive) ? _activeClause : "") +
+         QString(" ORDER BY %1 %2 LIMIT %3;")
+                 .arg(QString(_hasActive ? "active DESC," : ""), _numColName)
+                 .arg(limit);
+}
+
+/*! The columns of completerQuery() to show in the completer's popup. */
+QStringList VirtualClusterLineEdit::completerColumns() const
+{
+  QStringList columns("number");
+  if (_hasName)
+    columns << "name";
+  if (_hasDescription)
+    columns << "description";
+  if (_hasActive)
+    columns << "active_qtdisplayrole";
+  return columns;
+}
+
+/*! Forget the completer's suggestions and stop any lookup in progress. */
+void VirtualClusterLineEdit::clearCompleter()
+{
+  if (!_completer)
+    return;
+
+  _completerTimer->stop();
+  if (_completerSequence)
+  {
+    VirtualClusterCompleterThread::worker()->forget(this);
+    _completerSequence = 0;
+  }
+  static_cast<QStandardItemModel *>(_completer->model())->clear();
+  _completerPrefix.clear();
+  _completerTruncated = false;
+}
+
+void VirtualClusterLineEdit::showCompleter(const QString &prefix)
+{
+  int width = 0;
+  QTreeView * view = static_cast<QTreeView *>(_completer->popup());
+  _parsed = true;
+
+  if (_completer->model()->rowCount() > 0)
+  {
+    _completer->setCompletionPrefix(prefix);
+
+    QStringList columns = completerColumns();
+    for (int i = 0; i < _completerRecord.count(); i++)
     {
-      view->resizeColumnToContents(activeDCol);
-      width += view->columnWidth(activeDCol);
+      bool shown = columns.contains(_completerRecord.fieldName(i));
+      view->setColumnHidden(i, ! shown);
+      if (shown)
+      {
+        view->resizeColumnToContents(i);
+        width += view->columnWidth(i);
+      }
     }
   }
-  else
-    model->setQuery(QSqlQuery());
 
   if (width > 350)
     width = 350;
@@ -795,31 +920,45 @@ void VirtualClusterLineEdit::silentSetId(const int pId)
   }
   else
   {
-    XSqlQuery idQ;
-    idQ.prepare(_query + _idClause + QString(";"));
-    idQ.bindValue(":id", pId);
-    idQ.exec();
-    if (idQ.first())
+    QString    sql = _query + _idClause + QString(";");
+    QSqlQuery  lookup;
+    QSqlRecord record;
+    if (VirtualClusterCache::cache()->find(sql, pId, record))
+      lookup = VirtualClusterCache::cachedQuery(sql, pId, record);
+    else
+    {
+      XSqlQuery idQ;
+      idQ.prepare(sql);
+      idQ.bindValue(":id", pId);
+      idQ.exec();
+      if (idQ.first())
+      {
+        record = idQ.record();
+        lookup = idQ;
+        VirtualClusterCache::cache()->insert(sql, _cacheNotification, pId, record);
+      }
+      else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error setting id"),
+                                    idQ, __FILE__, __LINE__))
+        return;
+    }
+
+    if (! record.isEmpty())
     {
-      if (_completer)
-        static_cast<QSqlQueryModel* >(_completer->model())->setQuery(QSqlQuery());
+      clearCompleter();
 
       _id = pId;
       _valid = true;
 
-      _model->setQuery(idQ);
+      _model->setQuery(lookup);
 
-      setText(idQ.value("number").toString());
+      setText(record.value("number").toString());
       if (_hasName)
-        _name = (idQ.value("name").toString());
+        _name = (record.value("name").toString());
       if (_hasDescription)
-        _description = idQ.value("description").toString();
+        _description = record.value("description").toString();
       if (_hasActive)
-        setStrikeOut(!idQ.value("active").toBool());
+        setStrikeOut(!record.value("active").toBool());
     }
-    else if (ErrorReporter::error(QtCriticalMsg, this, tr("Error setting id"),
-                                  idQ, __FILE__, __LINE__))
-      return;
   }
 
   _parsed = true;
@@ -827,6 +966,54 @@ void VirtualClusterLineEdit::silentSetId(const int pId)
   emit parsed();
 }
 
+/*! Look up all of \a ids in one query and keep the records in the shared
+    cache, so that setting any of them on a cluster of this kind later
+    doesn't go back to the database. A form can call this with every id
+    it is about to show. Returns the number of \a ids now cached, or -1
+    on error. Nothing is kept unless this kind of cluster names the tables
+    that invalidate its lookups.
+ */
+int VirtualClusterLineEdit::prefetch(const QList<int> &ids)
+{
+  if (_cacheNotification.isEmpty())
+    return 0;
+
+  QString     sql = _query + _idClause + QString(";");
+  QStringList missing;
+  QSqlRecord  record;
+  int         found = 0;
+  foreach (int id, ids)
+  {
+    if (id < 0)
+      continue;
+    else if (VirtualClusterCache::cache()->find(sql, id, record))
+      found++;
+    else
+      missing << QString::number(id);
+  }
+  if (missing.isEmpty())
+    return found;
+
+  XSqlQuery idQ;
+  idQ.prepare(_query +
+              QString(_idClause).replace(":id", "ANY(CAST(:ids AS INTEGER[]))") +
+              QString(";"));
+  idQ.bindValue(":ids", "{" + missing.join(",") + "}");
+  idQ.exec();
+
+  while (idQ.next())
+  {
+    VirtualClusterCache::cache()->insert(sql, _cacheNotification,
+                                         idQ.value("id").toInt(), idQ.record());
+    found++;
+  }
+  if (ErrorReporter::error(QtCriticalMsg, this, tr("Error looking up records"),
+                           idQ, __FILE__, __LINE__))
+    return -1;
+
+  return found;
+}
+
 void VirtualClusterLineEdit::setNumber(const QString& pNumber)
 {
   _parsed = false;
@@ -869,6 +1056,11 @@ void VirtualClusterLineEdit::sParse()
         if (numQ.first())
 	{
 	    _valid = true;
+            // the row has every column setId() would look up, so it needn't
+            VirtualClusterCache::cache()->insert(_query + _idClause + QString(";"),
+                                                 _cacheNotification,
+                                                 numQ.value("id").toInt(),
+                                                 numQ.record());
             setId(numQ.value("id").toInt());
 	    if (_hasName)
               _name = (numQ.value("name").toString());
@@ -1173,12 +1365,12 @@ void VirtualList::sSearch(const QString& pTarget)
 {
   for (int i = 0; i < _listTab->columnCount(); i++)
   {
-    QList<XTreeWidgetItem*> matches = _listTab->findItems(pTarget, Qt::MatchStartsWith, i);
+    XTreeWidgetItem *match = _listTab->findFirstItem(pTarget, Qt::MatchStartsWith, i);
 
-    if (matches.size() > 0)
+    if (match)
     {
-      _listTab->setCurrentItem(matches[0]);
-      _listTab->scrollToItem(matches[0]);
+      _listTab->setCurrentItem(match);
+      _listTab->scrollToItem(match);
       return;
     }
   }
@@ -1199,6 +1391,13 @@ void VirtualList::sFillList()
                             .arg(QString(_parent->_hasActive ? "active DESC," : ""),
                                  QString(_parent->_hasName   ? "name"         : "number")));
     query.exec();
+
+    // sSearch() tries every column, so index them all for prefix searches
+    QList<int> searchColumns;
+    for (int i = 0; i < _listTab->columnCount(); i++)
+      searchColumns.append(i);
+    _listTab->setSearchColumns(searchColumns, Qt::MatchStartsWith);
+
     _listTab->populate(query);
 }
 
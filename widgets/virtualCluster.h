@@ -15,9 +15,12 @@
 #include "scriptablewidget.h"
 #include "widgets.h"
 #include "xlineedit.h"
+#include "xtreewidgetfetcher.h"
 
 #include <QDialog>
+#include <QMap>
 #include <QSqlQuery>
+#include <QSqlRecord>
 #include <QWidget>
 
 class GuiClientInterface;
@@ -30,6 +33,8 @@ class QMenu;
 class QPushButton;
 class QSpacerItem;
 class QSqlQueryModel;
+class QStandardItemModel;
+class QTimer;
 class QVBoxLayout;
 class VirtualClusterLineEdit;
 class XCheckBox;
@@ -177,6 +182,7 @@ class XTUPLEWIDGETS_EXPORT VirtualClusterLineEdit : public XLineEdit
                                const char *pExtra,
                                const char *pName         = 0,
                                const char *pActiveColumn = 0);
+       virtual ~VirtualClusterLineEdit();
 
        void setMenu(QMenu *menu);
        QMenu *menu() const { return _menu; }
@@ -193,6 +199,8 @@ class XTUPLEWIDGETS_EXPORT VirtualClusterLineEdit : public XLineEdit
        Q_INVOKABLE inline virtual QString name()        const { return _name; }
        Q_INVOKABLE inline virtual QString description() const { return _description; }
 
+       virtual int prefetch(const QList<int> &ids);
+
     public slots:
         virtual void clear();
         virtual QString extraClause() const { return _extraClause; }
@@ -243,6 +251,11 @@ class XTUPLEWIDGETS_EXPORT VirtualClusterLineEdit : public XLineEdit
 
         virtual void completerHighlighted(const QModelIndex &);
 
+        virtual void sCompleterFetch();
+        virtual void sCompleterResult(int sequence, const QSqlRecord &record,
+                                      const XTreeWidgetRowBatch &rows,
+                                      const QString &errorString);
+
     signals:
         void newId(int);
         void parsed();
@@ -253,6 +266,12 @@ class XTUPLEWIDGETS_EXPORT VirtualClusterLineEdit : public XLineEdit
         virtual void focusInEvent(QFocusEvent * event);
         virtual void resizeEvent(QResizeEvent *e);
 
+        virtual QString     completerQuery(const QString &prefix, int limit,
+                                           QMap<QString, QVariant> &bindings) const;
+        virtual QStringList completerColumns() const;
+        void                clearCompleter();
+        void                showCompleter(const QString &prefix);
+
         QAction* _infoAct;
         QAction* _openAct;
         QAction* _copyAct;
@@ -284,6 +303,13 @@ class XTUPLEWIDGETS_EXPORT VirtualClusterLineEdit : public XLineEdit
         bool _strict;
         bool _showInactive;
         int _completerId;
+        QString _cacheNotification;     // tables whose changes invalidate cached lookups
+        int _completerSequence;         // lookup being waited for, 0 if none
+        QString _completerFetchPrefix;  // prefix that lookup is for
+        QString _completerPrefix;       // prefix the completer model holds rows for
+        QSqlRecord _completerRecord;
+        QTimer* _completerTimer;
+        bool _completerTruncated;
 
         virtual void silentSetId(const int);
 
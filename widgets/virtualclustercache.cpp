@@ -0,0 +1,173 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "virtualclustercache.h"
+
+#include <QApplication>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlResult>
+#include <QStringList>
+
+#include "guiclientinterface.h"
+#include "virtualCluster.h"
+
+#define DEBUG false
+
+#define DEFAULTMAXRECORDS 1000   // per query
+
+VirtualClusterCache *VirtualClusterCache::_singleton = 0;
+
+/* A finished SELECT that found one cached record. It can't be run again;
+   it only answers what the lookup it stands in for would have.
+ */
+class VirtualClusterCachedResult : public QSqlResult
+{
+  public:
+    VirtualClusterCachedResult(const QSqlDriver *driver, const QString &query,
+                               int id, const QSqlRecord &record)
+      : QSqlResult(driver),
+        _record(record)
+    {
+      prepare(query);
+      bindValue(":id", id, QSql::In);
+      setSelect(true);
+      setActive(true);
+      setAt(QSql::BeforeFirstRow);
+    }
+
+  protected:
+    virtual QVariant   data(int i)              { return _record.value(i);  }
+    virtual bool       isNull(int i)            { return _record.isNull(i); }
+    virtual bool       reset(const QString &)   { return false; }
+    virtual bool       fetchFirst()             { return fetch(0); }
+    virtual bool       fetchLast()              { return fetch(0); }
+    virtual int        size()                   { return 1; }
+    virtual int        numRowsAffected()        { return 0; }
+    virtual QSqlRecord record() const           { return _record; }
+
+    virtual bool fetch(int i)
+    {
+      if (i != 0)
+        return false;
+      setAt(0);
+      return true;
+    }
+
+  private:
+    QSqlRecord _record;
+};
+
+VirtualClusterCache *VirtualClusterCache::cache()
+{
+  if (! _singleton)
+    _singleton = new VirtualClusterCache(QApplication::instance());
+
+  return _singleton;
+}
+
+VirtualClusterCache::VirtualClusterCache(QObject *parent)
+  : QObject(parent),
+    _maxRecords(DEFAULTMAXRECORDS)
+{
+  QSqlDatabase db = QSqlDatabase::database();
+  if (db.driver())
+    connect(db.driver(), SIGNAL(notification(const QString&)), this, SLOT(invalidate(const QString&)));
+  if (VirtualClusterLineEdit::_guiClientInterface)
+    connect(VirtualClusterLineEdit::_guiClientInterface, SIGNAL(dbConnectionLost()), this, SLOT(clear()));
+}
+
+VirtualClusterCache::~VirtualClusterCache()
+{
+  clear();
+}
+
+/*! Copy the record \a query found for \a id into \a record.
+    Returns false if there is none.
+ */
+bool VirtualClusterCache::find(const QString &query, int id, QSqlRecord &record)
+{
+  QCache<int, QSqlRecord> *records = _records.value(query);
+  QSqlRecord *found = records ? records->object(id) : 0;
+  if (! found)
+    return false;
+
+  record = *found;
+  if (DEBUG)
+    qDebug("VirtualClusterCache::find(%d) hit", id);
+  return true;
+}
+
+/*! Return a query positioned before the \a record that \a query, with
+    \a id bound to :id, found earlier. It gives a QSqlQueryModel the same
+    record(), lastQuery() and boundValue() as running the lookup would.
+ */
+QSqlQuery VirtualClusterCache::cachedQuery(const QString &query, int id, const QSqlRecord &record)
+{
+  return QSqlQuery(new VirtualClusterCachedResult(QSqlDatabase::database().driver(),
+                                                  query, id, record));
+}
+
+/*! Store the \a record \a query found for \a id until one of the
+    space-separated tables in \a notification is notified, the database
+    connection is lost, or it's the least recently used of more than
+    maxRecords() records found by \a query.
+ */
+void VirtualClusterCache::insert(const QString &query, const QString &notification,
+                                 int id, const QSqlRecord &record)
+{
+  QStringList tables = notification.split(" ", QString::SkipEmptyParts);
+  if (tables.isEmpty())
+    return;
+
+  QSqlDatabase db = QSqlDatabase::database();
+  foreach (QString table, tables)
+  {
+    if (db.driver() && ! db.driver()->subscribedToNotifications().contains(table))
+      db.driver()->subscribeToNotification(table);
+    _queries[table].insert(query);
+  }
+
+  QCache<int, QSqlRecord> *records = _records.value(query);
+  if (! records)
+  {
+    records = new QCache<int, QSqlRecord>(_maxRecords);
+    _records.insert(query, records);
+  }
+  records->insert(id, new QSqlRecord(record));
+}
+
+void VirtualClusterCache::setMaxRecords(int records)
+{
+  _maxRecords = records;
+  foreach (QCache<int, QSqlRecord> *cached, _records)
+    cached->setMaxCost(records);
+}
+
+void VirtualClusterCache::clear()
+{
+  qDeleteAll(_records);
+  _records.clear();
+  _queries.clear();
+}
+
+void VirtualClusterCache::invalidate(const QString &table)
+{
+  QHash<QString, QSet<QString> >::iterator it = _queries.find(table);
+  if (it == _queries.end())
+    return;
+
+  foreach (QString query, it.value())
+    delete _records.take(query);
+  _queries.erase(it);
+
+  if (DEBUG)
+    qDebug("VirtualClusterCache::invalidate(%s)", qPrintable(table));
+}
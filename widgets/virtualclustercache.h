@@ -0,0 +1,63 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef VIRTUALCLUSTERCACHE_H
+#define VIRTUALCLUSTERCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QString>
+
+/* The records cluster widgets look up by id, shared by every cluster in
+   the process so a form that shows the same customer, item, or account
+   many times only asks the database once.
+
+   Records are grouped by the query that found them, which stands for the
+   kind of cluster, and each group keeps its most recently used records.
+   A group is dropped when any of the tables it was stored with raises a
+   notification, the application saves a change to one of them (see the
+   GUIClient update slots), or the database connection is lost. Records stored
+   without tables aren't kept, since nothing would tell us they changed.
+ */
+class VirtualClusterCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    static VirtualClusterCache *cache();
+
+    bool find(const QString &query, int id, QSqlRecord &record);
+    static QSqlQuery cachedQuery(const QString &query, int id, const QSqlRecord &record);
+    void insert(const QString &query, const QString &notification,
+                int id, const QSqlRecord &record);
+    int  maxRecords() const { return _maxRecords; }
+    void setMaxRecords(int records);
+
+  public slots:
+    void clear();
+    void invalidate(const QString &table);
+
+  protected:
+    VirtualClusterCache(QObject *parent = 0);
+    virtual ~VirtualClusterCache();
+
+  private:
+    static VirtualClusterCache *_singleton;
+
+    QHash<QString, QCache<int, QSqlRecord>*> _records;  // by query
+    QHash<QString, QSet<QString> >           _queries;  // queries by table
+    int                                      _maxRecords;
+};
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "virtualclustercompleter.h"
+
+#include <QApplication>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#define DEBUG false
+
+VirtualClusterCompleterThread *VirtualClusterCompleterThread::_singleton = 0;
+
+VirtualClusterCompleterThread *VirtualClusterCompleterThread::worker()
+{
+  if (! _singleton)
+    _singleton = new VirtualClusterCompleterThread(QApplication::instance());
+
+  return _singleton;
+}
+
+VirtualClusterCompleterThread::VirtualClusterCompleterThread(QObject *parent)
+  : QThread(parent),
+    _sequence(0),
+    _quit(false)
+{
+  qRegisterMetaType<QSqlRecord>("QSqlRecord");
+  qRegisterMetaType<XTreeWidgetRowBatch>("XTreeWidgetRowBatch");
+}
+
+VirtualClusterCompleterThread::~VirtualClusterCompleterThread()
+{
+  {
+    QMutexLocker lock(&_mutex);
+    _quit = true;
+    _queue.clear();
+    _wake.wakeAll();
+  }
+  wait();
+  _singleton = 0;
+}
+
+/*! Queue \a sql with \a bindings for \a requester, replacing any request
+    of its that hasn't started, and return the sequence number its result
+    will carry.
+ */
+int VirtualClusterCompleterThread::request(const QObject *requester, const QString &sql,
+                                           const QMap<QString, QVariant> &bindings)
+{
+  QMutexLocker lock(&_mutex);
+
+  for (int i = _queue.size() - 1; i >= 0; i--)
+  {
+    if (_queue.at(i).requester == requester)
+      _queue.removeAt(i);
+  }
+
+  Request request;
+  request.sequence  = ++_sequence;
+  request.requester = requester;
+  request.sql       = sql;
+  request.bindings  = bindings;
+  _queue.append(request);
+  _latest.insert(requester, request.sequence);
+
+  if (! isRunning())
+    start();
+  _wake.wakeOne();
+
+  return request.sequence;
+}
+
+/*! Drop whatever \a requester has queued or running. */
+void VirtualClusterCompleterThread::forget(const QObject *requester)
+{
+  QMutexLocker lock(&_mutex);
+
+  for (int i = _queue.size() - 1; i >= 0; i--)
+  {
+    if (_queue.at(i).requester == requester)
+      _queue.removeAt(i);
+  }
+  _latest.remove(requester);
+}
+
+bool VirtualClusterCompleterThread::isCurrent(const Request &request)
+{
+  QMutexLocker lock(&_mutex);
+  return _latest.value(request.requester) == request.sequence;
+}
+
+void VirtualClusterCompleterThread::run()
+{
+  QString name = DbConnection::uniqueName("completer");
+  {
+    QSqlDatabase db;
+    forever
+    {
+      Request request;
+      {
+        QMutexLocker lock(&_mutex);
+        while (! _quit && _queue.isEmpty())
+          _wake.wait(&_mutex);
+        if (_quit)
+          break;
+        request = _queue.takeFirst();
+      }
+
+      QString errorString;
+      if (! db.isOpen())
+        db = _connection.open(name, errorString);
+      if (! db.isOpen())
+      {
+        if (isCurrent(request))
+          emit resultReady(request.sequence, QSqlRecord(), XTreeWidgetRowBatch(), errorString);
+        continue;
+      }
+
+      QSqlRecord          record;
+      XTreeWidgetRowBatch rows;
+      bool                reopen = false;
+      {
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        query.prepare(request.sql);
+        for (QMap<QString, QVariant>::const_iterator it = request.bindings.constBegin();
+             it != request.bindings.constEnd(); ++it)
+          query.bindValue(it.key(), it.value());
+
+        /* QPSQL reports a backend that went away as a StatementError
+           and leaves the connection open, so start over after any
+           failure rather than fail every lookup from then on
+         */
+        if (! query.exec())
+        {
+          errorString = query.lastError().text();
+          reopen      = true;
+        }
+        else if (isCurrent(request))
+        {
+          record = query.record();
+          rows   = XTreeWidgetRowBatch(record.count());
+          while (query.next())
+            rows.append(query);
+        }
+      }
+
+      if (reopen)
+      {
+        db = QSqlDatabase();    // reopened for the next request
+        DbConnection::remove(name);
+      }
+
+      if (isCurrent(request))
+        emit resultReady(request.sequence, record, rows, errorString);
+      else if (DEBUG)
+        qDebug("VirtualClusterCompleterThread dropped lookup %d", request.sequence);
+    }
+  }
+  DbConnection::remove(name);
+}
@@ -0,0 +1,79 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef VIRTUALCLUSTERCOMPLETER_H
+#define VIRTUALCLUSTERCOMPLETER_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QSqlRecord>
+#include <QThread>
+#include <QVariant>
+#include <QWaitCondition>
+
+#include "dbconnection.h"
+#include "xtreewidgetfetcher.h"
+
+/* Runs type-ahead lookups for every cluster in the process on one worker
+   thread with one database session, opened the first time it's needed
+   and kept for the life of the application.
+
+   request() queues a lookup and returns its sequence number. A newer
+   request from the same requester replaces one still waiting in the
+   queue, and the worker doesn't read or report the rows of a lookup that
+   was superseded while it ran. Results arrive through resultReady(); a
+   requester ignores every sequence number but the last one it was given.
+ */
+class VirtualClusterCompleterThread : public QThread
+{
+  Q_OBJECT
+
+  public:
+    static VirtualClusterCompleterThread *worker();
+
+    int  request(const QObject *requester, const QString &sql,
+                 const QMap<QString, QVariant> &bindings);
+    void forget(const QObject *requester);
+
+  signals:
+    void resultReady(int sequence, const QSqlRecord &record,
+                     const XTreeWidgetRowBatch &rows, const QString &errorString);
+
+  protected:
+    VirtualClusterCompleterThread(QObject *parent = 0);
+    virtual ~VirtualClusterCompleterThread();
+
+    virtual void run();
+
+  private:
+    struct Request
+    {
+      int                     sequence;
+      const QObject          *requester;
+      QString                 sql;
+      QMap<QString, QVariant> bindings;
+    };
+
+    bool isCurrent(const Request &request);
+
+    static VirtualClusterCompleterThread *_singleton;
+
+    DbConnection                _connection;
+    QMutex                      _mutex;
+    QWaitCondition              _wake;
+    QList<Request>              _queue;
+    QHash<const QObject*, int>  _latest;    // newest sequence by requester
+    int                         _sequence;
+    bool                        _quit;
+};
+
+#endif
@@ -190,6 +190,8 @@ SOURCES += widgets.cpp \
     vendorcluster.cpp \
     vendorgroup.cpp \
     virtualCluster.cpp \
+    virtualclustercache.cpp \
+    virtualclustercompleter.cpp \
     voucherCluster.cpp \
     warehouseCluster.cpp \
     warehousegroup.cpp \
@@ -197,6 +199,7 @@ SOURCES += widgets.cpp \
     workcenterCluster.cpp \
     xcheckbox.cpp \
     xcombobox.cpp \
+    xcomboboxcache.cpp \
     xdatawidgetmapper.cpp \
     xdoccopysetter.cpp \
     xdoublevalidator.cpp \
@@ -211,7 +214,13 @@ SOURCES += widgets.cpp \
     xtextedit.cpp \
     xtreeview.cpp \
     xtreewidget.cpp \
+    xtreewidgetexporter.cpp \
+    xtreewidgetfetcher.cpp \
+    xtreewidgetpager.cpp \
     xtreewidgetprogress.cpp \
+    xtreewidgetresultset.cpp \
+    xtreewidgetrunningtotal.cpp \
+    xtreewidgetsearchindex.cpp \
     xurllabel.cpp \
 
 HEADERS += widgets.h \
@@ -289,6 +298,8 @@ HEADERS += widgets.h \
     vendorcluster.h \
     vendorgroup.h \
     virtualCluster.h \
+    virtualclustercache.h \
+    virtualclustercompleter.h \
     voucherCluster.h \
     warehouseCluster.h \
     warehousegroup.h \
@@ -296,6 +307,7 @@ HEADERS += widgets.h \
     workcentercluster.h \
     xcheckbox.h \
     xcombobox.h \
+    xcomboboxcache.h \
     xcomboboxprivate.h \
     xdatawidgetmapper.h \
     xdoccopysetter.h \
@@ -311,7 +323,13 @@ HEADERS += widgets.h \
     xtextedit.h \
     xtreeview.h \
     xtreewidget.h \
+    xtreewidgetexporter.h \
+    xtreewidgetfetcher.h \
+    xtreewidgetpager.h \
     xtreewidgetprogress.h \
+    xtreewidgetresultset.h \
+    xtreewidgetrunningtotal.h \
+    xtreewidgetsearchindex.h \
     xurllabel.h \
 
 FORMS += alarmMaint.ui \
@@ -112,8 +112,7 @@ void WoLineEdit::silentSetId(const int pId)
     wo.exec();
     if (wo.first())
     {
-      if (_completer)
-        static_cast<QSqlQueryModel* >(_completer->model())->setQuery(QSqlQuery());
+      clearCompleter();
 
       _id    = pId;
       _valid = true;
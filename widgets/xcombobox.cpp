@@ -11,11 +11,14 @@
 #include <QAbstractItemView>
 #include <QDebug>
 #include <QDialog>
+#include <QKeyEvent>
 #include <QLabel>
 #include <QLayout>
 #include <QMouseEvent>
 #include <QPushButton>
+#include <QShowEvent>
 #include <QSqlDriver>
+#include <QSqlError>
 #include <QSqlRecord>
 #include <QSqlRelationalDelegate>
 #include <QSqlTableModel>
@@ -25,6 +28,7 @@
 #include <xsqlquery.h>
 
 #include "xcombobox.h"
+#include "xcomboboxcache.h"
 #include "xcomboboxprivate.h"
 #include "xdatawidgetmapper.h"
 #include "xsqltablemodel.h"
@@ -62,7 +66,6 @@ QHash<XComboBox::XComboBoxTypes, XComboBoxDescrip*> XComboBoxPrivate::typeDescri
 
 XComboBoxDescrip::XComboBoxDescrip()
   : type(XComboBox::Adhoc),
-    isDirty(true),
     isEditable(false)
 {
 }
@@ -79,7 +82,6 @@ XComboBoxDescrip::XComboBoxDescrip(XComboBox::XComboBoxTypes pType,
     uiName(pUi),
     privilege(pPriv),
     queryStr(pQry),
-    isDirty(true),
     isEditable(pEditable),
     notification(pNotification)
 {
@@ -87,46 +89,12 @@ XComboBoxDescrip::XComboBoxDescrip(XComboBox::XComboBoxTypes pType,
     params.append(pKey, pValue);
   else if (! pKey.isEmpty())
     params.append(pKey);
-
-  if (QSqlDatabase::database().isOpen())
-    query = MetaSQLQuery(queryStr).toQuery(params, QSqlDatabase(), false);
-  if (XComboBox::_guiClientInterface)
-    connect(XComboBox::_guiClientInterface, SIGNAL(dbConnectionLost()), this, SLOT(sDbConnectionLost()));
-
-  sListen();
 }
 
 XComboBoxDescrip::~XComboBoxDescrip()
 {
 }
 
-void XComboBoxDescrip::sDbConnectionLost()
-{
-  if (DEBUG) qDebug() << "XComboBoxDescrip::sDbConnectionLost()";
-  isDirty = true;
-}
-
-void XComboBoxDescrip::sListen()
-{
-  QSqlDatabase db = QSqlDatabase::database();
-  foreach (QString notice,
-           notification.split(" ", QString::SkipEmptyParts))
-  {
-    if (! db.driver()->subscribedToNotifications().contains(notice))
-    {
-      db.driver()->subscribeToNotification(notice);
-      connect(db.driver(), SIGNAL(notification(const QString&)),
-              this,        SLOT(sNotified(const QString&)));
-    }
-  }
-}
-
-void XComboBoxDescrip::sNotified(const QString &pNotification)
-{
-  Q_UNUSED(pNotification);
-  isDirty = true;
-}
-
 static QString bankaccntMQL("SELECT bankaccnt_id,"
                             "       bankaccnt_name || '-' || bankaccnt_descrip,"
                             "       bankaccnt_name"
@@ -204,6 +172,8 @@ XComboBoxPrivate::XComboBoxPrivate(XComboBox *pParent)
     _descrip(0),
     _editButton(0),
     _label(0),
+    _lazy(false),
+    _lazyPending(false),
     _parent(pParent),
     _popupCounter(0),
     _type(XComboBox::Adhoc),
@@ -801,7 +771,10 @@ XComboBoxPrivate::~XComboBoxPrivate()
 void XComboBoxPrivate::sEdit()
 {
   if (_descrip)
-    _descrip->isDirty = true;
+  {
+    foreach (QString table, _descrip->notification.split(" ", QString::SkipEmptyParts))
+      XComboBoxCache::cache()->invalidate(table);
+  }
   if (_editor && ! _slot->isEmpty())
   {
     QMetaObject::invokeMethod(_editor, _slot->data(), Qt::DirectConnection);
@@ -877,12 +850,6 @@ void XComboBoxPrivate::setType(XComboBox::XComboBoxTypes ptype)
 
   _type    = ptype;
   _descrip = typeDescrip.value(_type);
-  if (_descrip && _descrip->isDirty)
-  {
-    _descrip->sListen();
-    _descrip->query.exec();
-    _descrip->isDirty = _descrip->notification.isEmpty(); // empty => there's no notification to listen for
-  }
 
   addEditButton();
 }
@@ -966,6 +933,40 @@ QString XComboBox::nullStr() const
   return _data->_nullStr;
 }
 
+bool XComboBox::isLazy() const
+{
+  return _data->_lazy;
+}
+
+/*! In lazy mode the list isn't queried until it's needed: when the popup
+    is first shown, the user searches it, or code asks for the list or for
+    an id or code it can't yet answer. setId() before then fetches only
+    the one row it selects. Set this before setType() or populate().
+ */
+void XComboBox::setLazy(bool p)
+{
+  _data->_lazy = p;
+  if (! p)
+    ensurePopulated();
+}
+
+/*! Run the query deferred by lazy mode, if there is one. Call this before
+    reading count() or the item texts of a lazy XComboBox.
+ */
+void XComboBox::ensurePopulated()
+{
+  if (! _data->_lazyPending)
+    return;
+
+  if (DEBUG)
+    qDebug("%s::ensurePopulated()", qPrintable(objectName()));
+
+  bool lazy = _data->_lazy;
+  _data->_lazy = false;
+  populate(_data->_lazyMql, _data->_lazyParams, _data->_lazyNotification);
+  _data->_lazy = lazy;
+}
+
 void XComboBox::setDefaultCode(Defaults p)
 {
   _data->_default = p;
@@ -1098,7 +1099,8 @@ void XComboBox::setType(XComboBoxTypes pType)
   }
 
   if (_data->typeDescrip.contains(pType)) {     // allow for Adhoc
-    populate(_data->_descrip->query);
+    populate(_data->_descrip->queryStr, _data->_descrip->params,
+             _data->_descrip->notification);
   }
 
   switch (pType)
@@ -1106,11 +1108,13 @@ void XComboBox::setType(XComboBoxTypes pType)
     case PoProjects:
     case SoProjects:
     case WoProjects:
+      ensurePopulated();
       setEnabled(count() > 1);
       break;
 
     case Currencies:
     case CurrenciesNotBase:
+      ensurePopulated();
       if (count() <= 1)
       {
         hide();
@@ -1152,6 +1156,8 @@ void XComboBox::setCode(const QString &pString)
            qPrintable(objectName()), qPrintable(pString),
            _data->_codes.count(), _data->_ids.count());
 
+  ensurePopulated();
+
   if (pString.isEmpty())
   {
     setId(-1);
@@ -1159,25 +1165,22 @@ void XComboBox::setCode(const QString &pString)
   }
   else if (_data->_codes.count())
   {
-    for (int counter = 0; counter < _data->_codes.count(); counter++)
+    int counter = _data->_codeIndex.value(pString, -1);
+    if (counter >= 0)
     {
-      if (_data->_codes.at(counter) == pString)
-      {
-        if (DEBUG)
-          qDebug("%s::setCode(%s) found at %d with _ids.count %d & id %d",
-                 qPrintable(objectName()), qPrintable(pString),
-                 counter, _data->_ids.count(), id());
+      if (DEBUG)
+        qDebug("%s::setCode(%s) found at %d with _ids.count %d & id %d",
+               qPrintable(objectName()), qPrintable(pString),
+               counter, _data->_ids.count(), id());
 
-        if (_data->_ids.count() && id()!=_data->_ids.at(counter))
-          setId(_data->_ids.at(counter));
+      if (_data->_ids.count() && id()!=_data->_ids.at(counter))
+        setId(_data->_ids.at(counter));
 
-        return;
-      }
-      else if (DEBUG)
-        qDebug("%s::setCode(%s) not found (%s)",
-               qPrintable(objectName()), qPrintable(pString),
-               qPrintable(_data->_codes.at(counter)));
+      return;
     }
+    else if (DEBUG)
+      qDebug("%s::setCode(%s) not found",
+             qPrintable(objectName()), qPrintable(pString));
   }
   else  // this is an ad-hoc combobox without a query behind it?
   {
@@ -1201,6 +1204,30 @@ void XComboBox::setCode(const QString &pString)
 
 void XComboBox::setId(int pTarget)
 {
+  // a lazy list only needs the row being selected, unless it's a report
+  if (_data->_lazyPending && _data->_type == Reports)
+    ensurePopulated();
+  else if (_data->_lazyPending && pTarget >= 0 && ! _data->_idIndex.contains(pTarget))
+  {
+    QString mql = _data->_lazyMql.trimmed();
+    if (mql.endsWith(";"))
+      mql.chop(1);
+    ParameterList params = _data->_lazyParams;
+    params.append("xcombobox_id", pTarget);
+
+    MetaSQLQuery rowm("SELECT * FROM (" + mql + ") AS xcombobox_row(xcombobox_id)"
+                      " WHERE xcombobox_id = <? value('xcombobox_id') ?>;");
+    XSqlQuery rowq = rowm.toQuery(params);
+    if (rowq.first())
+    {
+      clear();
+      append(rowq.value(0).toInt(), rowq.value(1).toString(),
+             rowq.value(rowq.record().count() < 3 ? 1 : 2).toString());
+    }
+    else
+      ensurePopulated();
+  }
+
   // reports are a special case: they should really be stored by name, not id
   if (_data->_type == Reports)
   {
@@ -1215,33 +1242,10 @@ void XComboBox::setId(int pTarget)
     while (query.next())
     {
       int id = query.value("report_id").toInt();
-      for (int counter = 0; counter < count(); counter++)
-      {
-        if (_data->_ids.at(counter) == id)
-        {
-          if(this->id()!=id)
-          {
-            setCurrentIndex(counter);
-            updateMapperData();
-            emit newID(pTarget);
-            emit valid(true);
-
-            if (allowNull())
-              emit notNull(true);
-          }
-
-          return;
-        }
-      }
-    }
-  }
-  else
-  {
-    for (int counter = 0; counter < _data->_ids.count(); counter++)
-    {
-      if (_data->_ids.at(counter) == pTarget)
+      int counter = _data->_idIndex.value(id, -1);
+      if (counter >= 0 && counter < count())
       {
-        if(id()!=pTarget)
+        if(this->id()!=id)
         {
           setCurrentIndex(counter);
           updateMapperData();
@@ -1256,6 +1260,25 @@ void XComboBox::setId(int pTarget)
       }
     }
   }
+  else
+  {
+    int counter = _data->_idIndex.value(pTarget, -1);
+    if (counter >= 0)
+    {
+      if(id()!=pTarget)
+      {
+        setCurrentIndex(counter);
+        updateMapperData();
+        emit newID(pTarget);
+        emit valid(true);
+
+        if (allowNull())
+          emit notNull(true);
+      }
+
+      return;
+    }
+  }
 
   setNull();
 }
@@ -1270,6 +1293,8 @@ void XComboBox::setText(const QString &pString)
   if (pString == currentText())
     return;
 
+  ensurePopulated();
+
   if (count())
   {
     for (int counter = ((allowNull()) ? 1 : 0); counter < count(); counter++)
@@ -1337,10 +1362,16 @@ void XComboBox::clear()
   QComboBox::clear();
 
   if (_data->_ids.count())
+  {
     _data->_ids.clear();
+    _data->_idIndex.clear();
+  }
 
   if (_data->_codes.count())
+  {
     _data->_codes.clear();
+    _data->_codeIndex.clear();
+  }
 
   if (allowNull())
     append(-1, _data->_nullStr);
@@ -1358,6 +1389,7 @@ void XComboBox::populate(XSqlQuery pQuery, int pSelected)
     qDebug("%s::populate(%s, %d) entered",
            qPrintable(objectName()), qPrintable(pQuery.lastQuery()), pSelected);
 
+  _data->_lazyPending = false;
   int selected = (pSelected >= 0) ? pSelected : id();
   clear();
 
@@ -1383,6 +1415,65 @@ void XComboBox::populate(const QString & pSql, int pSelected)
   populate(query, pSelected);
 }
 
+/*! Populate from the MetaSQL query \a pMql run with \a pParams.
+
+    The rows are shared with every other XComboBox populated from the same
+    query and parameters until one of the space-separated tables in
+    \a pNotification is notified, so only the first of them queries the
+    database. If \a pNotification is empty the query runs every time.
+    In lazy mode an uncached query is deferred until the list is needed.
+ */
+void XComboBox::populate(const QString &pMql, const ParameterList &pParams,
+                         const QString &pNotification, int pSelected)
+{
+  if (DEBUG)
+    qDebug("%s::populate(%s, %d params, %s, %d) entered",
+           qPrintable(objectName()), qPrintable(pMql), pParams.count(),
+           qPrintable(pNotification), pSelected);
+
+  QString              key = XComboBoxCache::key(pMql, pParams);
+  XComboBoxCache::Rows rows;
+  bool                 cached = XComboBoxCache::cache()->find(key, rows);
+  if (! cached && _data->_lazy)
+  {
+    _data->_lazyMql          = pMql;
+    _data->_lazyParams       = pParams;
+    _data->_lazyNotification = pNotification;
+    _data->_lazyPending      = true;
+
+    int selected = (pSelected >= 0 || _data->_ids.isEmpty()) ? pSelected : id();
+    clear();
+    if (selected >= 0)
+      setId(selected);
+    return;
+  }
+
+  _data->_lazyPending = false;
+  if (! cached)
+  {
+    MetaSQLQuery mql(pMql);
+    XSqlQuery    query = mql.toQuery(pParams);
+    while (query.next())
+    {
+      XComboBoxCache::Row row;
+      row.id   = query.value(0).toInt();
+      row.text = query.value(1).toString();
+      row.code = query.record().count() < 3 ? row.text : query.value(2).toString();
+      rows.append(row);
+    }
+    if (query.lastError().type() == QSqlError::NoError)
+      XComboBoxCache::cache()->insert(key, pNotification, rows);
+  }
+
+  int selected = (pSelected >= 0 || _data->_ids.isEmpty()) ? pSelected : id();
+  clear();
+
+  for (int i = 0; i < rows.size(); i++)
+    append(rows.at(i).id, rows.at(i).text, rows.at(i).code);
+
+  setId(selected);
+}
+
 void XComboBox::append(int pId, const QString &pText)
 {
   append(pId,pText,pText);
@@ -1394,10 +1485,13 @@ void XComboBox::append(int pId, const QString &pText, const QString &pCode)
       qDebug("%s::append(%d, %s, %s)",
              qPrintable(objectName()), pId, qPrintable(pText), qPrintable(pCode));
 
-  if (! _data->_ids.contains(pId))
+  if (! _data->_idIndex.contains(pId))
   {
     addItem(pText);
+    _data->_idIndex.insert(pId, _data->_ids.count());
     _data->_ids.append(pId);
+    if (! _data->_codeIndex.contains(pCode))
+      _data->_codeIndex.insert(pCode, _data->_codes.count());
     _data->_codes.append(pCode);
   }
 }
@@ -1416,6 +1510,10 @@ int XComboBox::id(int pIndex) const
 
 int XComboBox::id() const
 {
+  // without a null row, an unpopulated lazy list's id is its first row's
+  if (_data->_lazyPending && _data->_ids.isEmpty())
+    const_cast<XComboBox*>(this)->ensurePopulated();
+
   if (_data->_ids.count() && currentIndex() != -1)
   {
     if ( (allowNull()) && (currentIndex() <= 0) )
@@ -1434,6 +1532,9 @@ QString XComboBox::code() const
            qPrintable(objectName()), currentIndex(), allowNull(),
            _data->_codes.count());
 
+  if (_data->_lazyPending && _data->_ids.isEmpty())
+    const_cast<XComboBox*>(this)->ensurePopulated();
+
   QString returnValue;
 
   if ( allowNull() && (currentIndex() <= 0) )
@@ -1484,6 +1585,12 @@ void XComboBox::sHandleNewIndex(int pIndex)
     qDebug("%s::sHandleNewIndex() returning", qPrintable(objectName()));
 }
 
+void XComboBox::keyPressEvent(QKeyEvent *event)
+{
+  ensurePopulated();
+  QComboBox::keyPressEvent(event);
+}
+
 void XComboBox::mousePressEvent(QMouseEvent *event)
 {
   emit clicked();
@@ -1491,17 +1598,27 @@ void XComboBox::mousePressEvent(QMouseEvent *event)
   QComboBox::mousePressEvent(event);
 }
 
+void XComboBox::showEvent(QShowEvent *event)
+{
+  if (_data->_lazyPending && _data->_ids.isEmpty())
+    ensurePopulated();      // the list's first row is what gets displayed
+
+  QComboBox::showEvent(event);
+}
+
 void XComboBox::wheelEvent(QWheelEvent *event)
 {
   if (_x_preferences)
     if (_x_preferences->boolean("DisableXComboBoxWheelEvent"))
       return;
 
+  ensurePopulated();
   QComboBox::wheelEvent(event);
 }
 
 void XComboBox::showPopup()
 {
+  ensurePopulated();
   QComboBox::showPopup();
   QAbstractItemView *itemView = view();
   if (_data->_editButton && _data->_popupCounter == 0)
@@ -19,7 +19,9 @@
 #include <xsqlquery.h>
 
 class QLabel;
+class QKeyEvent;
 class QMouseEvent;
+class QShowEvent;
 class QWheelEvent;
 class QScriptEngine;
 class XComboBoxPrivate;
@@ -31,6 +33,7 @@ class XTUPLEWIDGETS_EXPORT XComboBox : public QComboBox
 
   Q_PROPERTY(bool           allowNull             READ allowNull            WRITE setAllowNull                            )
   Q_PROPERTY(QString        nullStr               READ nullStr              WRITE setNullStr                              )
+  Q_PROPERTY(bool           lazy                  READ isLazy               WRITE setLazy                                 )
   Q_PROPERTY(XComboBoxTypes type                  READ type                 WRITE setType                                 )
   Q_PROPERTY(QString        code                  READ code                 WRITE setCode                 DESIGNABLE false)
   Q_PROPERTY(Defaults       defaultCode           READ defaultCode          WRITE setDefaultCode                          )
@@ -108,6 +111,10 @@ class XTUPLEWIDGETS_EXPORT XComboBox : public QComboBox
     QString           nullStr()              const;
     void              setNullStr(const QString &);
 
+    bool              isLazy()               const;
+    void              setLazy(bool);
+    Q_INVOKABLE void  ensurePopulated();
+
     Q_INVOKABLE QLabel* label()        const;
     Q_INVOKABLE void   setLabel(QLabel* pLab);
 
@@ -135,6 +142,7 @@ class XTUPLEWIDGETS_EXPORT XComboBox : public QComboBox
     void append(int, const QString &, const QString &);
     void populate(XSqlQuery, int = -1);
     void populate(const QString &, int = -1);
+    void populate(const QString &, const ParameterList &, const QString &, int = -1);
     void populate();
     void setDataWidgetMap(XDataWidgetMapper* m);
 
@@ -162,7 +170,9 @@ class XTUPLEWIDGETS_EXPORT XComboBox : public QComboBox
 
   protected:
     QString      currentDefault();
+    void         keyPressEvent(QKeyEvent *);
     void         mousePressEvent(QMouseEvent *);
+    void         showEvent(QShowEvent *);
     void         wheelEvent(QWheelEvent *);
 
     bool              _allowNull;
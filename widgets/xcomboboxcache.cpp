@@ -0,0 +1,110 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xcomboboxcache.h"
+
+#include <QApplication>
+#include <QLocale>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QStringList>
+
+#include "guiclientinterface.h"
+#include "xcombobox.h"
+
+#define DEBUG false
+
+XComboBoxCache *XComboBoxCache::_singleton = 0;
+
+XComboBoxCache *XComboBoxCache::cache()
+{
+  if (! _singleton)
+    _singleton = new XComboBoxCache(QApplication::instance());
+
+  return _singleton;
+}
+
+XComboBoxCache::XComboBoxCache(QObject *parent)
+  : QObject(parent)
+{
+  QSqlDatabase db = QSqlDatabase::database();
+  if (db.driver())
+    connect(db.driver(), SIGNAL(notification(const QString&)), this, SLOT(invalidate(const QString&)));
+  if (XComboBox::_guiClientInterface)
+    connect(XComboBox::_guiClientInterface, SIGNAL(dbConnectionLost()), this, SLOT(clear()));
+}
+
+/* the same query run with the same parameters, in any order, gets the
+   same key. the locale is included because queries may translate or
+   format the text they return.
+ */
+QString XComboBoxCache::key(const QString &query, const ParameterList &params)
+{
+  QStringList parts;
+  for (int i = 0; i < params.count(); i++)
+    parts << params.name(i) + QChar(0x1f) + params.value(i).toString();
+  parts.sort();
+
+  return QLocale().name() + QChar(0x1d) + query + QChar(0x1d) + parts.join(QChar(0x1d));
+}
+
+/*! Copy the list stored under \a key into \a rows.
+    Returns false if there is none.
+ */
+bool XComboBoxCache::find(const QString &key, Rows &rows) const
+{
+  QHash<QString, Rows>::const_iterator it = _rows.constFind(key);
+  if (it == _rows.constEnd())
+    return false;
+
+  rows = it.value();
+  if (DEBUG)
+    qDebug("XComboBoxCache::find() hit with %d rows", rows.size());
+  return true;
+}
+
+/*! Store \a rows under \a key until one of the space-separated tables in
+    \a notification is notified or the database connection is lost.
+ */
+void XComboBoxCache::insert(const QString &key, const QString &notification, const Rows &rows)
+{
+  QStringList tables = notification.split(" ", QString::SkipEmptyParts);
+  if (tables.isEmpty())
+    return;
+
+  QSqlDatabase db = QSqlDatabase::database();
+  foreach (QString table, tables)
+  {
+    if (db.driver() && ! db.driver()->subscribedToNotifications().contains(table))
+      db.driver()->subscribeToNotification(table);
+    _keys[table].insert(key);
+  }
+  _rows.insert(key, rows);
+}
+
+void XComboBoxCache::clear()
+{
+  _rows.clear();
+  _keys.clear();
+}
+
+void XComboBoxCache::invalidate(const QString &table)
+{
+  QHash<QString, QSet<QString> >::iterator it = _keys.find(table);
+  if (it == _keys.end())
+    return;
+
+  foreach (QString key, it.value())
+    _rows.remove(key);
+  _keys.erase(it);
+
+  if (DEBUG)
+    qDebug("XComboBoxCache::invalidate(%s)", qPrintable(table));
+}
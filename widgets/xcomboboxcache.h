@@ -0,0 +1,65 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XCOMBOBOXCACHE_H
+#define XCOMBOBOXCACHE_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <parameter.h>
+
+/* Combo box contents shared by every XComboBox in the process, so a
+   window with several combo boxes of the same type, or a second window
+   with the same lists, fills them without going back to the database.
+
+   Entries are keyed by the MetaSQL query, its parameters, and the locale.
+   An entry is dropped when any of the tables it was stored with raises a
+   notification or the database connection is lost. Lists stored without
+   tables aren't kept, since nothing would tell us they changed.
+ */
+class XComboBoxCache : public QObject
+{
+  Q_OBJECT
+
+  public:
+    struct Row
+    {
+      int     id;
+      QString text;
+      QString code;
+    };
+    typedef QVector<Row> Rows;
+
+    static XComboBoxCache *cache();
+
+    static QString key(const QString &query, const ParameterList &params);
+
+    bool find(const QString &key, Rows &rows) const;
+    void insert(const QString &key, const QString &notification, const Rows &rows);
+
+  public slots:
+    void clear();
+    void invalidate(const QString &table);
+
+  protected:
+    XComboBoxCache(QObject *parent = 0);
+
+  private:
+    static XComboBoxCache *_singleton;
+
+    QHash<QString, Rows>           _rows;
+    QHash<QString, QSet<QString> > _keys;     // cache keys by table
+};
+
+#endif
@@ -11,6 +11,7 @@
 #ifndef __XCOMBOBOXPRIVATE_H__
 #define __XCOMBOBOXPRIVATE_H__
 
+#include <QHash>
 #include <QList>
 #include <QPair>
 #include <QString>
@@ -34,19 +35,10 @@ class XComboBoxDescrip : public QObject
     QString                   uiName;
     QString                   privilege;
     QString                   queryStr;
-    bool                      isDirty;
     bool                      isEditable;
     QString                   notification;
 
     ParameterList             params;
-    XSqlQuery                 query;
-
-  public slots:
-    virtual void sDbConnectionLost();
-    virtual void sListen();
-
-  protected slots:
-    virtual void sNotified(const QString &pNotification);
 };
 
 class XComboBoxPrivate : public QObject
@@ -67,12 +59,19 @@ class XComboBoxPrivate : public QObject
 
   public:
     QList<QString>                       _codes;
+    QHash<QString, int>                  _codeIndex;    // first row with each code
     enum XComboBox::Defaults             _default;
     XComboBoxDescrip                    *_descrip;
     QPushButton                         *_editButton;
     QList<int>                           _ids;
+    QHash<int, int>                      _idIndex;      // row of each id
     QLabel                              *_label;
     int                                  _lastId;
+    bool                                 _lazy;
+    QString                              _lazyMql;      // query to run when needed
+    QString                              _lazyNotification;
+    ParameterList                        _lazyParams;
+    bool                                 _lazyPending;
     QString                              _nullStr;
     XComboBox                           *_parent;
     int                                  _popupCounter; // a real hack
@@ -8,6 +8,7 @@
  * to be bound by its terms.
  */
 
+#include <algorithm>
 #include <limits>
 
 #include "xtreewidget.h"
@@ -25,8 +26,10 @@
 #include <QMenu>
 #include <QMimeData>
 #include <QMouseEvent>
+#include <QPointer>
 #include <QProgressBar>
 #include <QPushButton>
+#include <QScrollBar>
 #include <QSqlError>
 #include <QSqlRecord>
 #include <QTextCharFormat>
@@ -36,11 +39,19 @@
 #include <QTextEdit>
 #include <QTextTable>
 #include <QTextTableCell>
+#include <QTextStream>
 #include <QTextTableFormat>
+#include <QTreeWidgetItemIterator>
 #include <QtScript>
 #include <QMessageBox>
 
+#include "xtreewidgetexporter.h"
+#include "xtreewidgetfetcher.h"
+#include "xtreewidgetpager.h"
 #include "xtreewidgetprogress.h"
+#include "xtreewidgetresultset.h"
+#include "xtreewidgetrunningtotal.h"
+#include "xtreewidgetsearchindex.h"
 #include "xtsettings.h"
 #include "xsqlquery.h"
 #include "format.h"
@@ -49,36 +60,16 @@
 
 #define WORKERINTERVAL 0
 #define WORKERROWS     500
-
-/* make sure the colroles are kept in sync with
-   QStringList knownroles in populate() below,
-   both in count and order
-   */
-#define COLROLE_DISPLAY       0
-#define COLROLE_TEXTALIGNMENT 1
-#define COLROLE_BACKGROUND    2
-#define COLROLE_FOREGROUND    3
-#define COLROLE_TOOLTIP       4
-#define COLROLE_STATUSTIP     5
-#define COLROLE_FONT          6
-#define COLROLE_KEY           7
-#define COLROLE_RUNNING       8
-#define COLROLE_RUNNINGINIT   9
-#define COLROLE_GROUPRUNNING  10
-#define COLROLE_TOTAL         11
-#define COLROLE_NUMERIC       12
-#define COLROLE_NULL          13
-#define COLROLE_ID            14
-// make sure COLROLE_COUNT = last COLROLE + 1
-#define COLROLE_COUNT         15
+#define SEARCHINDEXDELAY 250
+#define INTERNLIMIT    256
+#define CANCELWAIT     5000
+#define EXPORTROWS     500
 
 #define yesStr QObject::tr("Yes")
 #define noStr  QObject::tr("No")
 
 GuiClientInterface *XTreeWidget::_guiClientInterface = 0;
 
-static QTreeWidgetItem *searchChildren(XTreeWidgetItem *item, int pId);
-
 // cint() and round() regarding Issue #8897
 #include <cmath>
 
@@ -99,6 +90,189 @@ static double round(double r, int places)
   return cint(r*off)/off;
 }
 
+/* Sort keys are extracted once per row before sorting so the comparisons
+   don't repeat the QVariant conversions for every pair of rows. A key only
+   fills the fields its own type compares by. sortKeyLessThan() must stay
+   in sync with the ordering rules that XTreeWidgetItem::operator< has
+   always used because both share it.
+ */
+struct XTreeWidgetSortKey
+{
+  QVariant::Type type;
+  QVariant       value;    // to convert to another key's type
+  bool           bval;
+  int            ival;
+  qlonglong      llval;
+  double         dval;     // QVariant::toDouble()
+  double         strdval;  // QVariant::toString().toDouble()
+  QDate          date;
+  QDateTime      datetime;
+  QString        str;
+};
+
+/* fill the fields of key that compare as type, which is v's own type
+   unless v is being compared with a key of another type
+ */
+static void extractSortKey(const QVariant &v, XTreeWidgetSortKey &key,
+                           QVariant::Type type = QVariant::Invalid)
+{
+  key.type  = v.type();
+  key.value = v;
+  switch ((type == QVariant::Invalid) ? key.type : type)
+  {
+    case QVariant::Bool:
+      key.bval = v.toBool();
+      break;
+
+    case QVariant::Date:
+      key.date = v.toDate();
+      break;
+
+    case QVariant::DateTime:
+      key.datetime = v.toDateTime();
+      break;
+
+    case QVariant::Double:
+      key.dval = v.toDouble();
+      break;
+
+    case QVariant::Int:
+      key.ival = v.toInt();
+      break;
+
+    case QVariant::LongLong:
+      key.llval = v.toLongLong();
+      break;
+
+    case QVariant::String:
+      key.str     = v.toString();
+      key.strdval = key.str.toDouble();
+      key.dval    = v.toDouble();
+      break;
+
+    default:
+      break;
+  }
+}
+
+static bool sortKeyLessThanSameType(const XTreeWidgetSortKey &k1, const XTreeWidgetSortKey &k2)
+{
+  switch (k1.type)
+  {
+    case QVariant::Bool:
+      return !k1.bval && !(k2.type == QVariant::Bool && !k2.bval);
+
+    case QVariant::Date:
+      return k1.date < k2.date;
+
+    case QVariant::DateTime:
+      return k1.datetime < k2.datetime;
+
+    case QVariant::Double:
+      return k1.dval < k2.dval;
+
+    case QVariant::Int:
+      return k1.ival < k2.ival;
+
+    case QVariant::LongLong:
+      return k1.llval < k2.llval;
+
+    case QVariant::String:
+      if (k1.strdval == 0.0 && k2.dval == 0.0)
+        return k1.str < k2.str;
+      else if (k1.strdval == 0.0 && k2.dval)  //k1 is string, k2 is number
+        return false; //the number should always be treated as greater than a string
+      else if (k1.dval && k2.strdval == 0.0)
+        return true;
+      return k1.dval < k2.dval;
+
+    default:
+      break;
+  }
+  return false;
+}
+
+/* k1's type decides how the two compare, so a k2 of another type, such
+   as a null in a column of dates, is converted to it first
+ */
+static bool sortKeyLessThan(const XTreeWidgetSortKey &k1, const XTreeWidgetSortKey &k2)
+{
+  if (k2.type == k1.type)
+    return sortKeyLessThanSameType(k1, k2);
+
+  XTreeWidgetSortKey converted;
+  extractSortKey(k2.value, converted, k1.type);
+  return sortKeyLessThanSameType(k1, converted);
+}
+
+/* Orders row indices by the sort keys of one or more columns.
+   keys holds columns.size() keys per row, row-major.
+ */
+class XTreeWidgetSortCompare
+{
+  public:
+    XTreeWidgetSortCompare(const QVector<XTreeWidgetSortKey> &keys,
+                           const QList<Qt::SortOrder> &orders)
+      : _keys(keys), _orders(orders)
+    {
+    }
+
+    bool operator()(int row1, int row2) const
+    {
+      int keycnt = _orders.size();
+      for (int i = 0; i < keycnt; i++)
+      {
+        const XTreeWidgetSortKey &k1 = _keys.at(row1 * keycnt + i);
+        const XTreeWidgetSortKey &k2 = _keys.at(row2 * keycnt + i);
+        if (_orders.at(i) == Qt::AscendingOrder)
+        {
+          if (sortKeyLessThan(k1, k2))
+            return true;
+          if (sortKeyLessThan(k2, k1))
+            return false;
+        }
+        else
+        {
+          if (sortKeyLessThan(k2, k1))
+            return true;
+          if (sortKeyLessThan(k1, k2))
+            return false;
+        }
+      }
+      return false;
+    }
+
+  private:
+    const QVector<XTreeWidgetSortKey> &_keys;
+    const QList<Qt::SortOrder>        &_orders;
+};
+
+/* true if the top-level row at idx can stay where it is when sorting by
+   col, which only needs it to be in order with the rows next to it
+ */
+static bool isInSortOrder(QTreeWidget *tree, int idx, int col, Qt::SortOrder order)
+{
+  XTreeWidgetSortKey key;
+  extractSortKey(tree->topLevelItem(idx)->data(col, Xt::RawRole), key);
+
+  XTreeWidgetSortKey other;
+  if (idx > 0)
+  {
+    extractSortKey(tree->topLevelItem(idx - 1)->data(col, Xt::RawRole), other);
+    if ((order == Qt::AscendingOrder) ? sortKeyLessThan(key, other)
+                                      : sortKeyLessThan(other, key))
+      return false;
+  }
+  if (idx + 1 < tree->topLevelItemCount())
+  {
+    extractSortKey(tree->topLevelItem(idx + 1)->data(col, Xt::RawRole), other);
+    if ((order == Qt::AscendingOrder) ? sortKeyLessThan(other, key)
+                                      : sortKeyLessThan(key, other))
+      return false;
+  }
+  return true;
+}
+
 XTreeWidget::XTreeWidget(QWidget *pParent) :
   QTreeWidget(pParent)
 {
@@ -113,15 +287,29 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   _sord    = Qt::AscendingOrder;
   _linear  = false;
   _alwaysLinear = true;
+  _lazy    = false;
 
   _colIdx     = 0;  // querycol = _colIdx[xtreecol]
   _colRole    = 0;  // querycol = _colRole[xtreecol][roleid]
+  _plan       = 0;
   _fieldCount = 0;
   _last       = 0;
   for (int i = 0; i < ROWROLE_COUNT; i++)
     _rowRole[i] = 0;
   _progress = 0;
-  _subtotals = 0;
+  _runningRows  = 0;
+  _runningChildren = false;
+  _appendedFrom = -1;
+  _idIndexDirty = true;
+  _fetch         = 0;
+  _fetchIndex    = -1;
+  _fetchUseAltId = false;
+  _fetchCount    = 0;
+  _searchMode       = XTreeWidgetSearchIndex::StartsWith | XTreeWidgetSearchIndex::Contains;
+  _searchIndex      = 0;
+  _searchIndexBuild = 0;
+  _searchIndexTimer.setSingleShot(true);
+  _searchIndexTimer.setInterval(SEARCHINDEXDELAY);
 
   setUniformRowHeights(true); //#13439 speed improvement if all rows are known to be the same height
   setContextMenuPolicy(Qt::CustomContextMenu);
@@ -142,6 +330,27 @@ XTreeWidget::XTreeWidget(QWidget *pParent) :
   connect(this,           SIGNAL(itemChanged(QTreeWidgetItem*, int)),                       SLOT(sItemChanged(QTreeWidgetItem*, int)));
   connect(this,           SIGNAL(itemClicked(QTreeWidgetItem*, int)),                       SLOT(sItemClicked(QTreeWidgetItem*, int)));
   connect(&_workingTimer, SIGNAL(timeout()), this, SLOT(populateWorker()));
+  connect(model(), SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+          this,    SLOT(sRowsInserted(const QModelIndex &, int, int)));
+  connect(model(), SIGNAL(rowsAboutToBeRemoved(const QModelIndex &, int, int)),
+          this,    SLOT(sInvalidateIdIndex()));
+  connect(model(), SIGNAL(layoutChanged()), this, SLOT(sInvalidateIdIndex()));
+  connect(model(), SIGNAL(modelReset()),    this, SLOT(sInvalidateIdIndex()));
+  connect(model(), SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+          this,    SLOT(sRunningRowsChanged(const QModelIndex &, int, int)));
+  connect(model(), SIGNAL(rowsAboutToBeRemoved(const QModelIndex &, int, int)),
+          this,    SLOT(sRunningRowsChanged(const QModelIndex &, int, int)));
+  connect(model(), SIGNAL(layoutChanged()), this, SLOT(sInvalidateRunningTotals()));
+  connect(model(), SIGNAL(modelReset()),    this, SLOT(sInvalidateRunningTotals()));
+  connect(model(), SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+          this,    SLOT(sInvalidateSearchIndex()));
+  connect(model(), SIGNAL(rowsRemoved(const QModelIndex &, int, int)),
+          this,    SLOT(sInvalidateSearchIndex()));
+  connect(model(), SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &)),
+          this,    SLOT(sSearchDataChanged(const QModelIndex &, const QModelIndex &)));
+  connect(model(), SIGNAL(layoutChanged()), this, SLOT(sInvalidateSearchIndex()));
+  connect(model(), SIGNAL(modelReset()),    this, SLOT(sInvalidateSearchIndex()));
+  connect(&_searchIndexTimer, SIGNAL(timeout()), this, SLOT(sBuildSearchIndex()));
 
   emit valid(false);
   setColumnCount(0);
@@ -172,19 +381,23 @@ XTreeWidget::~XTreeWidget()
 {
   qApp->restoreOverrideCursor();
 
-  cleanupAfterPopulate();
-
-  if (_subtotals)
+  // including fetches that were cancelled but haven't noticed yet
+  foreach (XTreeWidgetFetchThread *fetch, findChildren<XTreeWidgetFetchThread *>())
   {
-    for (int i = 0; i < _subtotals->size(); i++)
+    fetch->cancel();
+    if (! fetch->wait(CANCELWAIT))
     {
-      delete (*_subtotals)[i];
-      _subtotals->replace(i, 0);
+      fetch->terminateBackend();
+      fetch->wait();
     }
-    delete _subtotals;
-    _subtotals = 0;
   }
 
+  cleanupAfterPopulate();
+
+  // index builds still running are children and wait in their destructors
+  delete _searchIndex;
+  _searchIndex = 0;
+
   if (_x_preferences)
   {
       xtsettingsSetValue( _settingsName + "/isForgetful",       _forgetful);
@@ -216,6 +429,54 @@ XTreeWidget::~XTreeWidget()
   _roles.clear();
 }
 
+XTreeWidgetColumnPlan::XTreeWidgetColumnPlan(const QVector<QVariant> &alignment)
+  : _defaultScale(decimalPlaces("")),
+    _alignment(alignment),
+    _strings(alignment.size()),
+    _interning(alignment.size(), true)
+{
+}
+
+int XTreeWidgetColumnPlan::scale(const QString &numericrole)
+{
+  QHash<QString, int>::const_iterator it = _scales.constFind(numericrole);
+  if (it != _scales.constEnd())
+    return it.value();
+  return *_scales.insert(numericrole, decimalPlaces(numericrole));
+}
+
+QVariant XTreeWidgetColumnPlan::color(const QString &name)
+{
+  QHash<QString, QVariant>::const_iterator it = _colors.constFind(name);
+  if (it != _colors.constEnd())
+    return it.value();
+  return *_colors.insert(name, namedColor(name));
+}
+
+/* return a copy of text that shares its data with equal text seen earlier
+   in the same column. columns with more than INTERNLIMIT distinct values,
+   such as document numbers and amounts, stop being interned.
+ */
+QString XTreeWidgetColumnPlan::intern(int col, const QString &text)
+{
+  if (col < 0 || col >= _interning.size() || ! _interning.at(col))
+    return text;
+
+  QSet<QString> &strings = _strings[col];
+  QSet<QString>::const_iterator it = strings.constFind(text);
+  if (it != strings.constEnd())
+    return *it;
+
+  if (strings.size() >= INTERNLIMIT)
+  {
+    _interning[col] = false;
+    strings.clear();
+    return text;
+  }
+  strings.insert(text);
+  return text;
+}
+
 void XTreeWidget::populate(const QString &pSql, bool pUseAltId)
 {
   XSqlQuery query(pSql);
@@ -243,6 +504,7 @@ void XTreeWidget::populate(XSqlQuery pQuery, int pIndex, bool pUseAltId, Populat
 
   pQuery.seek(-1);
 
+  sCancelFetch();
   if (popstyle == Replace)
   {
     clear();
@@ -257,6 +519,172 @@ void XTreeWidget::populate(XSqlQuery pQuery, int pIndex, bool pUseAltId, Populat
     _workingTimer.start(WORKERINTERVAL);
 }
 
+/*! Populate the list from \a metasql without blocking the GUI thread.
+
+    The query runs on a separate database connection in a worker thread,
+    which converts the results into batches of plain values. The GUI
+    thread only turns those batches into items, so the window stays
+    responsive while the database works. The results replace the current
+    contents of the list. \a bindings are bound by name after the MetaSQL
+    has been expanded, as display does for characteristic parameters.
+    \a connection says which database session to open for the query,
+    such as DbConnection::reporting().
+
+    populated() is emitted when all rows have been added. If the query
+    fails, populateFailed() is emitted instead. Cancel from the progress
+    bar, with Escape, or with sCancelFetch() keeps the rows received so
+    far and cancels the statement on the server if it is still running.
+ */
+void XTreeWidget::populateAsync(const QString &metasql,
+                                const ParameterList &params,
+                                const QMap<QString, QVariant> &bindings,
+                                int pIndex, bool pUseAltId,
+                                const DbConnection &connection)
+{
+  _fetchIndex    = (pIndex < 0) ? id() : pIndex;
+  _fetchUseAltId = pUseAltId;
+  _fetchCount    = 0;
+
+  clear();
+  _workingTimer.stop();
+  _workingParams.clear();
+  _linear = false;
+
+  _fetch = new XTreeWidgetFetchThread(metasql, params, bindings, this, connection);
+  connect(_fetch, SIGNAL(recordReady(QSqlRecord, int)),
+          this,   SLOT(sFetchRecordReady(QSqlRecord, int)));
+  connect(_fetch, SIGNAL(rowsReady(XTreeWidgetRowBatch)),
+          this,   SLOT(sFetchRowsReady(XTreeWidgetRowBatch)));
+  connect(_fetch, SIGNAL(finished()), this, SLOT(sFetchFinished()));
+  _fetch->start();
+
+  // let the user stop the query before it returns any rows
+  showProgress(0);
+}
+
+bool XTreeWidget::isFetching() const
+{
+  return _fetch != 0;
+}
+
+/*! Replace the contents of the list with \a rows that have already been
+    read, such as a result kept in a cache, without running a query.
+    \a record describes the fields of \a rows the same way
+    XSqlQuery::record() does for populate().
+ */
+void XTreeWidget::populateRows(const QSqlRecord &record,
+                               const XTreeWidgetRowBatch &rows,
+                               int pIndex, bool pUseAltId)
+{
+  sCancelFetch();
+  clear();
+  _workingTimer.stop();
+  _workingParams.clear();
+  _linear = true;
+
+  QList<XTreeWidgetItem*> topLevelItems; //#13439
+  XTreeWidgetBatchRow     row(rows);
+  if (_roles.size() <= 0)  // old-style populate by column/result order
+  {
+    cleanupAfterPopulate();
+    _fieldCount = record.count();
+  }
+  else if (rows.rowCount() > 0)
+    preparePopulate(record, rows.rowCount());
+
+  for (int i = 0; i < rows.rowCount(); i++)
+  {
+    row.setRow(i);
+    if (_roles.size() <= 0)
+      populateOldStyleRow(row, pUseAltId);
+    else
+      populateRow(row, pUseAltId, topLevelItems);
+  }
+  this->addTopLevelItems(topLevelItems);
+
+  setId(pIndex);
+  emit valid(currentItem() != 0);
+
+  finishPopulate();
+}
+
+/*! Stop a populateAsync() that is still running.
+    Rows already added stay in the list.
+ */
+void XTreeWidget::sCancelFetch()
+{
+  if (! _fetch)
+    return;
+
+  XTreeWidgetFetchThread *fetch = _fetch;
+  _fetch = 0;
+
+  disconnect(fetch, 0, this, 0);
+  fetch->cancel();
+  connect(fetch, SIGNAL(finished()), fetch, SLOT(deleteLater()));
+  if (fetch->isFinished())
+    fetch->deleteLater();
+
+  cleanupAfterPopulate();
+  if (DEBUG)
+    qDebug("%s::sCancelFetch()", qPrintable(objectName()));
+}
+
+void XTreeWidget::sFetchRecordReady(const QSqlRecord &record, int size)
+{
+  if (! _fetch || sender() != _fetch)
+    return;
+
+  if (_roles.size() <= 0)  // old-style populate by column/result order
+    _fieldCount = record.count();
+  else
+    preparePopulate(record, size);
+}
+
+void XTreeWidget::sFetchRowsReady(const XTreeWidgetRowBatch &batch)
+{
+  if (! _fetch || sender() != _fetch || _fetch->isCancelled())
+    return;
+
+  QList<XTreeWidgetItem*> topLevelItems; //#13439
+  XTreeWidgetBatchRow     row(batch);
+  for (int i = 0; i < batch.rowCount(); i++)
+  {
+    row.setRow(i);
+    if (_roles.size() <= 0)
+      populateOldStyleRow(row, _fetchUseAltId);
+    else
+      populateRow(row, _fetchUseAltId, topLevelItems);
+  }
+  this->addTopLevelItems(topLevelItems);
+
+  _fetchCount += batch.rowCount();
+  if (_progress)
+    _progress->setValue(_fetchCount);
+}
+
+void XTreeWidget::sFetchFinished()
+{
+  if (! _fetch || sender() != _fetch)
+    return;
+
+  XTreeWidgetFetchThread *fetch = _fetch;
+  _fetch = 0;
+  fetch->deleteLater();
+
+  if (! fetch->errorString().isEmpty())
+  {
+    cleanupAfterPopulate();
+    emit populateFailed(fetch->errorString());
+    return;
+  }
+
+  setId(_fetchIndex);
+  emit valid(currentItem() != 0);
+
+  finishPopulate();
+}
+
 void XTreeWidget::populateWorker()
 {
   if (_workingParams.isEmpty())
@@ -289,21 +717,10 @@ void XTreeWidget::populateWorker()
     if (pQuery.first())
     {
       _fieldCount = pQuery.count();
+      XTreeWidgetQueryRow row(pQuery);
       do
-      {
-        if (pUseAltId)
-          _last = new XTreeWidgetItem(this, _last, pQuery.value(0).toInt(),
-                                     pQuery.value(1).toInt(),
-                                     pQuery.value(2).toString());
-        else
-          _last = new XTreeWidgetItem(this, _last, pQuery.value(0).toInt(),
-                                     pQuery.value(1));
-
-        if (_fieldCount > ((pUseAltId) ? 3 : 2))
-          for (int col = ((pUseAltId) ? 3 : 2); col < _fieldCount; col++)
-            _last->setText((col - ((pUseAltId) ? 2 : 1)),
-                          pQuery.value(col).toString());
-      } while (pQuery.next());
+        populateOldStyleRow(row, pUseAltId);
+      while (pQuery.next());
     }
   }
 
@@ -314,460 +731,796 @@ void XTreeWidget::populateWorker()
   if (pQuery.at() == QSql::BeforeFirstRow || (pQuery.at() == 0 && ! _colIdx))
   {
     if (pQuery.first())
-    {
-      cleanupAfterPopulate(); // plug memory leaks if last populate() never finished
-
-      _fieldCount = pQuery.count();
-      // TODO: rewrite code to use a qmap or some other structure that
-      //       doesn't require initializing a Vector or new'd array values
-      _colIdx = new QVector<int>(_roles.size());
+      preparePopulate(pQuery.record(), pQuery.size());
+  }
 
-      _colRole = new QVector<int *>(_roles.size(), 0);
-      for (int ref = 0; ref < _roles.size(); ++ref)
-        (*_colRole)[ref] = new int[COLROLE_COUNT];
+  int cnt = 0;
 
-      if (! _subtotals)
+  if (pQuery.at() >= 0) // if the query returned any rows at all
+  {
+    XTreeWidgetQueryRow row(pQuery);
+    do
+    {
+      ++cnt;
+      if (!_linear && cnt % WORKERROWS == 0)
       {
-        _subtotals = new QList<QMap<int, double> *>();
-        for (int i = 0; i < _fieldCount; i++)
-          _subtotals->append(new QMap<int, double>());
+        this->addTopLevelItems(topLevelItems); //#13439
+        _progress->setValue(pQuery.at());
+        return;
       }
 
-      QSqlRecord  currRecord = pQuery.record();
+      populateRow(row, pUseAltId, topLevelItems);
+    } while (pQuery.next());
+  }
+
+  this->addTopLevelItems(topLevelItems); //#13439
+
+  setId(pIndex);
+  emit valid(currentItem() != 0);
+
+  // clean up. we won't reach here until the query is done, even if ! _linear
+  _workingTimer.stop();
+
+  if (_workingParams.size())
+    _workingParams.takeFirst();
+
+  finishPopulate();
+
+  if (_linear)
+    qApp->restoreOverrideCursor();
+}
+
+/* add one item per row the way populate() did before column roles */
+void XTreeWidget::populateOldStyleRow(const XTreeWidgetRow &row, bool pUseAltId)
+{
+  if (pUseAltId)
+    _last = new XTreeWidgetItem(this, _last, row.value(0).toInt(),
+                               row.value(1).toInt(),
+                               row.value(2).toString());
+  else
+    _last = new XTreeWidgetItem(this, _last, row.value(0).toInt(),
+                               row.value(1));
+
+  if (_fieldCount > ((pUseAltId) ? 3 : 2))
+    for (int col = ((pUseAltId) ? 3 : 2); col < _fieldCount; col++)
+      _last->setText((col - ((pUseAltId) ? 2 : 1)),
+                    row.value(col).toString());
+}
 
-      // apply indent, hidden and delete roles to col 0 if the caller requested them
-      // keep synchronized with #define ROWROLE_* above
-      if (rootIsDecorated())
+/* set up the column and role maps for a result with the given fields.
+   size is the number of rows to expect, or -1 if unknown.
+ */
+void XTreeWidget::preparePopulate(const QSqlRecord &record, int size)
+{
+  cleanupAfterPopulate(); // plug memory leaks if last populate() never finished
+
+  _fieldCount = record.count();
+  // TODO: rewrite code to use a qmap or some other structure that
+  //       doesn't require initializing a Vector or new'd array values
+  _colIdx = new QVector<int>(_roles.size());
+
+  _colRole = new QVector<int *>(_roles.size(), 0);
+  for (int ref = 0; ref < _roles.size(); ++ref)
+    (*_colRole)[ref] = new int[COLROLE_COUNT];
+
+  // apply indent, hidden and delete roles to col 0 if the caller requested them
+  // keep synchronized with #define ROWROLE_* above
+  if (rootIsDecorated())
+  {
+    _rowRole[ROWROLE_INDENT] = record.indexOf("xtindentrole");
+    if (_rowRole[ROWROLE_INDENT] < 0)
+      _rowRole[ROWROLE_INDENT] = 0;
+  }
+  else
+    _rowRole[ROWROLE_INDENT] = 0;
+
+  _rowRole[ROWROLE_HIDDEN] = record.indexOf("xthiddenrole");
+  if (_rowRole[ROWROLE_HIDDEN] < 0)
+    _rowRole[ROWROLE_HIDDEN] = 0;
+
+  _rowRole[ROWROLE_DELETED] = record.indexOf("xtdeletedrole");
+  if (_rowRole[ROWROLE_DELETED] < 0)
+    _rowRole[ROWROLE_DELETED] = 0;
+
+  // keep synchronized with #define COLROLE_* above
+  // TODO: get rid of COLROLE_* above and replace this QStringList
+  // with a map or vector of known roles and their Qt:: role or Xt
+  // enum values
+  QStringList knownroles;
+  knownroles << "qtdisplayrole"      << "qttextalignmentrole"<<
+  "qtbackgroundrole"   << "qtforegroundrole"<<
+  "qttooltiprole"      << "qtstatustiprole"<<
+  "qtfontrole" << "xtkeyrole"<<
+  "xtrunningrole"      << "xtrunninginit"<<
+  "xtgrouprunningrole" << "xttotalrole"<<
+  "xtnumericrole" << "xtnullrole"<<
+  "xtidrole";
+  for (int wcol = 0; wcol < _roles.size(); wcol++)
+  {
+    QVariantMap *role = _roles.value(wcol);
+    if (!role)
+    {
+      qWarning("XTreeWidget::populate() there is no role for column %d", wcol);
+      continue;
+    }
+    QString colname = role->value("qteditrole").toString();
+    (*_colIdx)[wcol] = record.indexOf(colname);
+
+    for (int k = 0; k < knownroles.size(); k++)
+    {
+      // apply Qt roles to a whole row by applying to each column
+      (*_colRole)[wcol][k] = knownroles.at(k).startsWith("qt") ?
+                         record.indexOf(knownroles.at(k)) :
+                         0;
+      if ((*_colRole)[wcol][k] > 0)
       {
-        _rowRole[ROWROLE_INDENT] = currRecord.indexOf("xtindentrole");
-        if (_rowRole[ROWROLE_INDENT] < 0)
-          _rowRole[ROWROLE_INDENT] = 0;
+        role->insert(knownroles.at(k),
+                      QString(knownroles.at(k)));
       }
       else
-        _rowRole[ROWROLE_INDENT] = 0;
-
-      _rowRole[ROWROLE_HIDDEN] = currRecord.indexOf("xthiddenrole");
-      if (_rowRole[ROWROLE_HIDDEN] < 0)
-        _rowRole[ROWROLE_HIDDEN] = 0;
-
-      _rowRole[ROWROLE_DELETED] = currRecord.indexOf("xtdeletedrole");
-      if (_rowRole[ROWROLE_DELETED] < 0)
-        _rowRole[ROWROLE_DELETED] = 0;
-
-      // keep synchronized with #define COLROLE_* above
-      // TODO: get rid of COLROLE_* above and replace this QStringList
-      // with a map or vector of known roles and their Qt:: role or Xt
-      // enum values
-      QStringList knownroles;
-      knownroles << "qtdisplayrole"      << "qttextalignmentrole"<<
-      "qtbackgroundrole"   << "qtforegroundrole"<<
-      "qttooltiprole"      << "qtstatustiprole"<<
-      "qtfontrole" << "xtkeyrole"<<
-      "xtrunningrole"      << "xtrunninginit"<<
-      "xtgrouprunningrole" << "xttotalrole"<<
-      "xtnumericrole" << "xtnullrole"<<
-      "xtidrole";
-      for (int wcol = 0; wcol < _roles.size(); wcol++)
+        (*_colRole)[wcol][k] = 0;
+
+      // apply column-specific roles second to override entire row settings
+      int colspecific = record.indexOf(colname + "_" + knownroles.at(k));
+      if (colspecific >= 0)
       {
-        QVariantMap *role = _roles.value(wcol);
-        if (!role)
-        {
-          qWarning("XTreeWidget::populate() there is no role for column %d", wcol);
-          continue;
-        }
-        QString colname = role->value("qteditrole").toString();
-        (*_colIdx)[wcol] = currRecord.indexOf(colname);
+        (*_colRole)[wcol][k] = colspecific;
+        role->insert(knownroles.at(k),
+                      QString(colname + "_" + knownroles.at(k)));
+        if (knownroles.at(k) == "xtrunningrole")
+          headerItem()->setData(wcol, Qt::UserRole, "xtrunningrole");
+        else if (knownroles.at(k) == "xttotalrole")
+                      headerItem()->setData(wcol, Qt::UserRole, "xttotalrole");
+      }
+    }
 
-        for (int k = 0; k < knownroles.size(); k++)
-        {
-          // apply Qt roles to a whole row by applying to each column
-          (*_colRole)[wcol][k] = knownroles.at(k).startsWith("qt") ?
-                             currRecord.indexOf(knownroles.at(k)) :
-                             0;
-          if ((*_colRole)[wcol][k] > 0)
-          {
-            role->insert(knownroles.at(k),
-                          QString(knownroles.at(k)));
-          }
-          else
-            (*_colRole)[wcol][k] = 0;
+    // Negative NUMERIC ROLE => default for column instead of column index
+    // see below
+    if (!(*_colRole)[wcol][COLROLE_NUMERIC] &&
+                      headerItem()->data(wcol, Xt::ScaleRole).isValid())
+    {
+      bool  ok;
+      int   tmpscale = headerItem()->data(wcol, Xt::ScaleRole).toInt(&ok);
+      if (ok)
+      {
+        if (DEBUG)
+          qDebug("setting _colRole[%d][COLROLE_NUMERIC]: %d", wcol, 0-tmpscale);
+        (*_colRole)[wcol][COLROLE_NUMERIC] = 0 - tmpscale;
+      }
+    }
+  }
 
-          // apply column-specific roles second to override entire row settings
-          if (currRecord.indexOf(colname + "_" + knownroles.at(k)) >=0)
-          {
-            (*_colRole)[wcol][k] = currRecord.indexOf(colname + "_" + knownroles.at(k));
-            role->insert(knownroles.at(k),
-                          QString(colname + "_" + knownroles.at(k)));
-            if (knownroles.at(k) == "xtrunningrole")
-              headerItem()->setData(wcol, Qt::UserRole, "xtrunningrole");
-            else if (knownroles.at(k) == "xttotalrole")
-                          headerItem()->setData(wcol, Qt::UserRole, "xttotalrole");
-          }
-        }
+  QVector<QVariant> alignment(_roles.size());
+  for (int col = 0; col < _roles.size(); col++)
+    alignment[col] = headerItem()->textAlignment(col);
+  _plan = new XTreeWidgetColumnPlan(alignment);
 
-        // Negative NUMERIC ROLE => default for column instead of column index
-        // see below
-        if (!(*_colRole)[wcol][COLROLE_NUMERIC] &&
-                          headerItem()->data(wcol, Xt::ScaleRole).isValid())
-        {
-          bool  ok;
-          int   tmpscale = headerItem()->data(wcol, Xt::ScaleRole).toInt(&ok);
-          if (ok)
-          {
-            if (DEBUG)
-              qDebug("setting _colRole[%d][COLROLE_NUMERIC]: %d", wcol, 0-tmpscale);
-            (*_colRole)[wcol][COLROLE_NUMERIC] = 0 - tmpscale;
-          }
-        }
+  if (_lazy)
+    _resultSet = QSharedPointer<XTreeWidgetResultSet>(
+                    new XTreeWidgetResultSet(_fieldCount, *_colIdx,
+                                             *_colRole, *_plan));
+  else
+    _resultSet.clear();
+
+  if (_rowRole[ROWROLE_INDENT])
+    setIndentation( 10);
+  else
+    setIndentation( 0);
+
+  if (! _linear || _progress)
+    showProgress(size);
+}
+
+/* show the progress bar and its Stop button. a maximum of 0 shows
+   a busy indicator for a query the server is still executing.
+ */
+void XTreeWidget::showProgress(int maximum)
+{
+  if (! _progress)
+  {
+    _progress = new XTreeWidgetProgress(this);
+    connect(_progress, SIGNAL(cancel()), &_workingTimer, SLOT(stop()));
+    connect(_progress, SIGNAL(cancel()), this, SLOT(sCancelFetch()));
+  }
+  _progress->setValue(0);
+  _progress->setMaximum(maximum);
+  _progress->show();
+}
+
+/* create the item for one result row and attach it below the right parent.
+   top-level items are collected in topLevelItems for the caller to add
+   in bulk (#13439).
+ */
+void XTreeWidget::populateRow(const XTreeWidgetRow &row, bool pUseAltId,
+                              QList<XTreeWidgetItem*> &topLevelItems)
+{
+  int id         = row.value(0).toInt();
+  int altId      = (pUseAltId) ? row.value(1).toInt() : -1;
+  int indent     = 0;
+  int lastindent = 0;
+  if (_rowRole[ROWROLE_INDENT])
+  {
+    indent = row.value(_rowRole[ROWROLE_INDENT]).toInt();
+    if (indent < 0)
+      indent = 0;
+    if (_last)
+    {
+      lastindent = _last->data(0, Xt::IndentRole).toInt();
+      if (DEBUG)
+            qDebug("getting Xt::IndentRole from %p of %d", _last, lastindent);
+    }
+  }
+  if (DEBUG)
+            qDebug("%s::populate() with id %d altId %d indent %d lastindent %d",
+            qPrintable(objectName()), id, altId, indent, lastindent);
+
+  QObject *parentItem = 0;
+  XTreeWidgetItem *previousItem = _last;
+  _last = new XTreeWidgetItem((XTreeWidgetItem*)0, id, altId);
+  if (_resultSet)
+  {
+    _last->_resultSet = _resultSet;
+    _last->_resultRow = _resultSet->appendRow(row);
+  }
+
+  if (indent == 0 || ! previousItem)
+    parentItem = this;
+  else if (lastindent < indent)
+    parentItem = previousItem;
+  else if (lastindent == indent)
+    parentItem = dynamic_cast<XTreeWidgetItem*>(previousItem->QTreeWidgetItem::parent());
+  else if (lastindent > indent)
+  {
+    XTreeWidgetItem *prev = (XTreeWidgetItem *)(previousItem->QTreeWidgetItem::parent());
+    while (prev &&
+           prev->data(0, Xt::IndentRole).toInt() >= indent)
+      prev = (XTreeWidgetItem *)(prev->QTreeWidgetItem::parent());
+    if (prev)
+      parentItem = prev;
+    else
+      parentItem = this;
+  }
+  else
+    parentItem = this;
+
+  fillRowItem(_last, row, indent, parentItem != this);
+
+  if (qobject_cast<XTreeWidget*>(parentItem))
+  {
+    //#13439 optimization - do not add items to 'this' until the very end
+    if(parentItem == this)
+      topLevelItems.append(_last);
+    else
+      qobject_cast<XTreeWidget*>(parentItem)->addTopLevelItem(_last);
+  }
+  else if (qobject_cast<XTreeWidgetItem*>(parentItem))
+    qobject_cast<XTreeWidgetItem*>(parentItem)->addChild(_last);
+}
+
+/* set the cell data of item from one result row.
+   indent is the row's xtindentrole value, already clamped to >= 0.
+   child says whether item goes under another item instead of the list.
+   returns whether the row should be hidden, since setHidden() does
+   nothing until the item is in the tree.
+ */
+bool XTreeWidget::fillRowItem(XTreeWidgetItem *item, const XTreeWidgetRow &row,
+                              int indent, bool child)
+{
+  bool hidden = false;
+  if (_rowRole[ROWROLE_INDENT])
+    item->setData(0, Xt::IndentRole, indent);
+
+  if (_rowRole[ROWROLE_HIDDEN])
+  {
+    if (DEBUG)
+      qDebug("%s::populate() found xthiddenrole, value = %s",
+              qPrintable( objectName()),
+              qPrintable( row.value(_rowRole[ROWROLE_HIDDEN]).toString()));
+    hidden = row.value(_rowRole[ROWROLE_HIDDEN]).toBool();
+    item->setHidden(hidden);
+  }
+
+  item->_compact = ! _resultSet;
+
+  bool allNull = (indent > 0);
+  for (int col = 0; col < _roles.size(); col++)
+  {
+    QVariantMap *role = _roles.value(col);
+    if (!role)
+    {
+      qWarning("XTreeWidget::populate() there is no role for column %d", col);
+      continue;
+    }
+
+    QVariant rawValue;
+    if(_colIdx->at(col) >=0)  //#13439 optimization - only try to retrieve value if index is valid
+      rawValue = row.value(_colIdx->at(col));
+    if (! _resultSet && rawValue.type() == QVariant::String)
+      rawValue = _plan->intern(col, rawValue.toString());
+
+    if (! _resultSet)
+      item->setData(col, Xt::RawRole, rawValue);
+    else if (col == _roles.size() - 1)
+    {
+      // QTreeWidgetItem::columnCount() only counts columns holding data
+      item->setData(col, Xt::RawRole, rawValue);
+    }
+
+    // TODO: this isn't necessary for all columns so do less often?
+    int     scale        = _plan->defaultScale();
+    QString numericrole  = "";
+    if ((*_colRole)[col][COLROLE_NUMERIC])
+    {
+      // Negative NUMERIC ROLE => default for column instead of column index
+      // see above
+      if ((*_colRole)[col][COLROLE_NUMERIC] < 0)
+        scale = 0 - (*_colRole)[col][COLROLE_NUMERIC];
+      else
+      {
+        numericrole  = row.value((*_colRole)[col][COLROLE_NUMERIC]).toString();
+        scale        = _plan->scale(numericrole);
       }
+    }
 
-      if (_rowRole[ROWROLE_INDENT])
-        setIndentation( 10);
+    // a negative numeric role is the header's scale, which data() falls back to
+    if (! _resultSet &&
+        ((*_colRole)[col][COLROLE_NUMERIC] > 0 ||
+         (! (*_colRole)[col][COLROLE_NUMERIC] &&
+          ((*_colRole)[col][COLROLE_RUNNING] || (*_colRole)[col][COLROLE_TOTAL]))))
+      item->setData(col, Xt::ScaleRole, scale);
+
+    /* if qtdisplayrole IS NULL then let the raw value shine through.
+       this allows UNIONS to do interesting things, like put dates and
+       text into the same visual column without SQL errors.
+    */
+    if (_resultSet)
+    {
+      ; // XTreeWidgetItem::data() formats the cell when the view needs it
+    }
+    else if ((*_colRole)[col][COLROLE_DISPLAY] &&
+        !row.value((*_colRole)[col][COLROLE_DISPLAY]).isNull())
+    {
+      /* this might not handle PostgreSQL NUMERICs properly
+         but at least it will try to handle INTEGERs and DOUBLEs
+         and it will avoid formatting sales order numbers with decimal
+         and group separators
+      */
+      QVariant field = row.value((*_colRole)[col][COLROLE_DISPLAY]);
+      if (field.type() == QVariant::Int)
+        item->setData(col, Qt::DisplayRole,
+                      _plan->locale().toString(field.toInt()));
+      else if (field.type() == QVariant::Double)
+        item->setData(col, Qt::DisplayRole,
+                      _plan->locale().toString(field.toDouble(),
+                                         'f', scale));
+      else
+        item->setData(col, Qt::DisplayRole, _plan->intern(col, field.toString()));
+    }
+    else if (rawValue.isNull())
+    {
+      item->setData(col, Qt::DisplayRole,
+                    (*_colRole)[col][COLROLE_NULL] ?
+                    _plan->intern(col, row.value((*_colRole)[col][COLROLE_NULL]).toString()) :
+                    QString(""));
+    }
+    else if ((*_colRole)[col][COLROLE_NUMERIC] &&
+             ((numericrole == "percent") ||
+              (numericrole == "scrap")))
+    {
+      item->setData(col, Qt::DisplayRole,
+                      _plan->locale().toString(rawValue.toDouble() * 100.0,
+                                       'f', scale));
+    }
+    else if ((*_colRole)[col][COLROLE_NUMERIC] || rawValue.type() == QVariant::Double)
+    {
+      // Issue #8897
+      item->setData(col, Qt::DisplayRole,
+                      _plan->locale().toString(round(rawValue.toDouble(), scale),
+                                       'f', scale));
+    }
+    else if (rawValue.type() == QVariant::Bool)
+    {
+      item->setData(col, Qt::DisplayRole,
+                    _plan->intern(col, rawValue.toBool() ? yesStr : noStr));
+    }
+    // otherwise data() shows the raw value as the display text
+
+    if (indent)
+    {
+      if (!(*_colRole)[col][COLROLE_DISPLAY] ||
+          ((*_colRole)[col][COLROLE_DISPLAY] &&
+           row.value((*_colRole)[col][COLROLE_DISPLAY]).isNull()))
+        allNull &= (rawValue.isNull() || rawValue.toString().isEmpty());
       else
-        setIndentation( 0);
+        allNull &= row.value((*_colRole)[col][COLROLE_DISPLAY]).isNull() ||
+                   row.value((*_colRole)[col][COLROLE_DISPLAY]).toString().isEmpty();
+
+      if (DEBUG)
+        qDebug("%s::populate() allNull = %d at %d for rawValue %s",
+                qPrintable( objectName()), allNull, col,
+                qPrintable( rawValue.toString()));
+    }
 
-      if (! _linear && ! _progress)
+    if (! _resultSet)
+    {
+      if ((*_colRole)[col][COLROLE_FOREGROUND])
       {
-        _progress = new XTreeWidgetProgress(this);
-        connect(_progress, SIGNAL(cancel()), &_workingTimer, SLOT(stop()));
+        QVariant fg = row.value((*_colRole)[col][COLROLE_FOREGROUND]);
+        if (!fg.isNull())
+          item->setData(col, Qt::ForegroundRole, _plan->color(fg.toString()));
       }
-      if (_progress)
+
+      if ((*_colRole)[col][COLROLE_BACKGROUND])
       {
-        _progress->setValue(0);
-        _progress->setMaximum(pQuery.size());
-        _progress->show();
+        QVariant bg = row.value((*_colRole)[col][COLROLE_BACKGROUND]);
+        if (!bg.isNull())
+          item->setData(col, Qt::BackgroundRole, _plan->color(bg.toString()));
       }
-    }
-  }
 
-  int defaultScale = decimalPlaces("");
-  int cnt = 0;
+      if ((*_colRole)[col][COLROLE_TEXTALIGNMENT])
+      {
+        QVariant alignment = row.value((*_colRole)[col][COLROLE_TEXTALIGNMENT]);
+        if (!alignment.isNull())
+          item->setData(col, Qt::TextAlignmentRole, alignment);
+        else if (_plan->alignment(col).isValid())
+          // don't let data() fall back to the column's alignment
+          item->setData(col, Qt::TextAlignmentRole, int(Qt::AlignLeft | Qt::AlignVCenter));
+      }
+      // otherwise data() falls back to the column's alignment
 
-  if (pQuery.at() >= 0) // if the query returned any rows at all
-    do
-    {
-      ++cnt;
-      if (!_linear && cnt % WORKERROWS == 0)
+      if ((*_colRole)[col][COLROLE_TOOLTIP])
       {
-        this->addTopLevelItems(topLevelItems); //#13439
-        _progress->setValue(pQuery.at());
-        return;
+        QVariant tooltip = row.value((*_colRole)[col][COLROLE_TOOLTIP]);
+        if (!tooltip.isNull() )
+          item->setData(col, Qt::ToolTipRole, tooltip);
       }
 
-      int id         = pQuery.value(0).toInt();
-      int altId      = (pUseAltId) ? pQuery.value(1).toInt() : -1;
-      int indent     = 0;
-      int lastindent = 0;
-      if (_rowRole[ROWROLE_INDENT])
+      if ((*_colRole)[col][COLROLE_STATUSTIP])
       {
-        indent = pQuery.value(_rowRole[ROWROLE_INDENT]).toInt();
-        if (indent < 0)
-          indent = 0;
-        if (_last)
-        {
-          lastindent = _last->data(0, Xt::IndentRole).toInt();
-          if (DEBUG)
-                qDebug("getting Xt::IndentRole from %p of %d", _last, lastindent);
-        }
+        QVariant statustip = row.value((*_colRole)[col][COLROLE_STATUSTIP]);
+        if (!statustip.isNull())
+          item->setData(col, Qt::StatusTipRole, statustip);
       }
-      if (DEBUG)
-                qDebug("%s::populate() with id %d altId %d indent %d lastindent %d",
-                qPrintable(objectName()), id, altId, indent, lastindent);
-
-      QObject *parentItem = 0;
-      XTreeWidgetItem *previousItem = _last;
-      _last = new XTreeWidgetItem((XTreeWidgetItem*)0, id, altId);
-
-      if (indent == 0)
-        parentItem = this;
-      else if (lastindent < indent)
-        parentItem = previousItem;
-      else if (lastindent == indent)
-        parentItem = dynamic_cast<XTreeWidgetItem*>(previousItem->QTreeWidgetItem::parent());
-      else if (lastindent > indent)
+
+      if ((*_colRole)[col][COLROLE_FONT])
       {
-        XTreeWidgetItem *prev = (XTreeWidgetItem *)(previousItem->QTreeWidgetItem::parent());
-        while (prev &&
-               prev->data(0, Xt::IndentRole).toInt() >= indent)
-          prev = (XTreeWidgetItem *)(prev->QTreeWidgetItem::parent());
-        if (prev)
-          parentItem = prev;
-        else
-          parentItem = this;
+        QVariant font = row.value((*_colRole)[col][COLROLE_FONT]);
+        if (!font.isNull())
+          item->setData(col, Qt::FontRole, font);
       }
-      else
-        parentItem = this;
 
-      if (_rowRole[ROWROLE_INDENT])
-        _last->setData(0, Xt::IndentRole, indent);
+      if ((*_colRole)[col][COLROLE_RUNNINGINIT])
+      {
+        QVariant runninginit = row.value((*_colRole)[col][COLROLE_RUNNINGINIT]);
+        if (!runninginit.isNull())
+          item->setData(col, Xt::RunningInitRole, runninginit);
+      }
 
-      if (_rowRole[ROWROLE_HIDDEN])
+      if ((*_colRole)[col][COLROLE_ID])
       {
-        if (DEBUG)
-          qDebug("%s::populate() found xthiddenrole, value = %s",
-                  qPrintable( objectName()),
-                  qPrintable( pQuery.value(_rowRole[ROWROLE_HIDDEN]).toString()));
-        _last->setHidden(pQuery.value(_rowRole[ROWROLE_HIDDEN]).toBool());
+        QVariant id = row.value((*_colRole)[col][COLROLE_ID]);
+        if (!id.isNull())
+          item->setData(col, Xt::IdRole, id);
       }
+    }
 
-      bool allNull = (indent > 0);
-      for (int col = 0; col < _roles.size(); col++)
+    if ((*_colRole)[col][COLROLE_RUNNING])
+    {
+      int set = row.value((*_colRole)[col][COLROLE_RUNNING]).toInt();
+      item->setData(col, Xt::RunningSetRole, set);
+
+      /* XTreeWidgetItem::data() shows top-level subtotals via runningTotal().
+         child rows keep the subtotal over every row populated before them.
+       */
+      QMap<int, double> &subtotals = _childSubtotals[col];
+      if (! subtotals.contains(set))
+        subtotals.insert(set, (*_colRole)[col][COLROLE_RUNNINGINIT] ?
+                              row.value((*_colRole)[col][COLROLE_RUNNINGINIT]).toDouble() : 0.0);
+      subtotals[set] += rawValue.toDouble();
+      if (child)
       {
-        QVariantMap *role = _roles.value(col);
-        if (!role)
-        {
-          qWarning("XTreeWidget::populate() there is no role for column %d", col);
-          continue;
-        }
+        item->setData(col, Qt::DisplayRole,
+                      _plan->locale().toString(subtotals.value(set), 'f', scale));
+        _runningChildren = true;
+      }
+    }
 
-        QVariant rawValue;
-        if(_colIdx->at(col) >=0)  //#13439 optimization - only try to retrieve value if index is valid
-          rawValue = pQuery.value(_colIdx->at(col));
+    if ((*_colRole)[col][COLROLE_TOTAL])
+    {
+      item->setData(col, Xt::TotalSetRole,
+                    row.value((*_colRole)[col][COLROLE_TOTAL]).toInt());
+    }
 
-        _last->setData(col, Xt::RawRole, rawValue);
+    if (_rowRole[ROWROLE_DELETED])
+    {
+      if (DEBUG)
+        qDebug("%s::populate() found xtdeleterole, value = %s",
+                qPrintable( objectName()),
+                qPrintable( row.value(_rowRole[ROWROLE_DELETED]).toString()));
+      if (row.value(_rowRole[ROWROLE_DELETED]).toBool())
+      {
+        item->setData(col,Xt::DeletedRole, QVariant(true));
+        QFont font = item->font(col);
+        font.setStrikeOut(true);
+        item->setFont(col, font);
+        item->setTextColor(Qt::gray);
+      }
+    }
+    /*
+    if ((*_colRole)[col][COLROLE_KEY])
+      item->setData(col, KeyRole, row.value((*_colRole)[col][COLROLE_KEY]));
+    if ((*_colRole)[col][COLROLE_GROUPRUNNING])
+      item->setData(col, GroupRunningRole, row.value((*_colRole)[col][COLROLE_GROUPRUNNING]));
+    */
+  }
 
-        // TODO: this isn't necessary for all columns so do less often?
-        int     scale        = defaultScale;
-        QString numericrole  = "";
-        if ((*_colRole)[col][COLROLE_NUMERIC])
-        {
-          // Negative NUMERIC ROLE => default for column instead of column index
-          // see above
-          if ((*_colRole)[col][COLROLE_NUMERIC] < 0)
-            scale = 0 - (*_colRole)[col][COLROLE_NUMERIC];
-          else
-          {
-            numericrole  = pQuery.value((*_colRole)[col][COLROLE_NUMERIC]).toString();
-            scale        = decimalPlaces(numericrole);
-          }
-        }
+  if (allNull && indent > 0)
+  {
+    qWarning("%s::populate() hiding indented row because it's empty",
+             qPrintable(objectName()));
+    hidden = true;
+    item->setHidden(true);
+  }
+  return hidden;
+}
 
-        if ((*_colRole)[col][COLROLE_NUMERIC] ||
-            (*_colRole)[col][COLROLE_RUNNING] ||
-            (*_colRole)[col][COLROLE_TOTAL])
-          _last->setData(col, Xt::ScaleRole, scale);
-
-        /* if qtdisplayrole IS NULL then let the raw value shine through.
-           this allows UNIONS to do interesting things, like put dates and
-           text into the same visual column without SQL errors.
-        */
-        if ((*_colRole)[col][COLROLE_DISPLAY] &&
-            !pQuery.value((*_colRole)[col][COLROLE_DISPLAY]).isNull())
-        {
-          /* this might not handle PostgreSQL NUMERICs properly
-             but at least it will try to handle INTEGERs and DOUBLEs
-             and it will avoid formatting sales order numbers with decimal
-             and group separators
-          */
-          QVariant field = pQuery.value((*_colRole)[col][COLROLE_DISPLAY]);
-          if (field.type() == QVariant::Int)
-            _last->setData(col, Qt::DisplayRole,
-                          QLocale().toString(field.toInt()));
-          else if (field.type() == QVariant::Double)
-            _last->setData(col, Qt::DisplayRole,
-                          QLocale().toString(field.toDouble(),
-                                             'f', scale));
-          else
-            _last->setData(col, Qt::DisplayRole, field.toString());
-        }
-        else if (rawValue.isNull())
-        {
-          _last->setData(col, Qt::DisplayRole,
-                        (*_colRole)[col][COLROLE_NULL] ?
-                        pQuery.value((*_colRole)[col][COLROLE_NULL]).toString() :
-                        "");
-        }
-        else if ((*_colRole)[col][COLROLE_NUMERIC] &&
-                 ((numericrole == "percent") ||
-                  (numericrole == "scrap")))
-        {
-          _last->setData(col, Qt::DisplayRole,
-                          QLocale().toString(rawValue.toDouble() * 100.0,
-                                           'f', scale));
-        }
-        else if ((*_colRole)[col][COLROLE_NUMERIC] || rawValue.type() == QVariant::Double)
-        {
-          // Issue #8897
-          _last->setData(col, Qt::DisplayRole,
-                          QLocale().toString(round(rawValue.toDouble(), scale),
-                                           'f', scale));
-        }
-        else if (rawValue.type() == QVariant::Bool)
-        {
-          _last->setData(col, Qt::DisplayRole,
-                        rawValue.toBool() ? yesStr : noStr);
-        }
-        else
-        {
-          _last->setData(col, Qt::EditRole, rawValue);
-        }
+void XTreeWidget::finishPopulate()
+{
+  cleanupAfterPopulate();
 
-        if (indent)
-        {
-          if (!(*_colRole)[col][COLROLE_DISPLAY] ||
-              ((*_colRole)[col][COLROLE_DISPLAY] &&
-               pQuery.value((*_colRole)[col][COLROLE_DISPLAY]).isNull()))
-            allNull &= (rawValue.isNull() || rawValue.toString().isEmpty());
-          else
-            allNull &= pQuery.value((*_colRole)[col][COLROLE_DISPLAY]).isNull() ||
-                       pQuery.value((*_colRole)[col][COLROLE_DISPLAY]).toString().isEmpty();
-
-          if (DEBUG)
-            qDebug("%s::populate() allNull = %d at %d for rawValue %s",
-                    qPrintable( objectName()), allNull, col,
-                    qPrintable( rawValue.toString()));
-        }
+  if (_appendedFrom >= 0)  // a pager's next page, already in order
+    populateCalculatedColumns(_appendedFrom);
+  else
+  {
+    populateCalculatedColumns();
+    if (sortColumn() >= 0 && header()->isSortIndicatorShown())
+      sortItems(sortColumn(), header()->sortIndicatorOrder());
+  }
 
-        if ((*_colRole)[col][COLROLE_FOREGROUND])
-        {
-          QVariant fg = pQuery.value((*_colRole)[col][COLROLE_FOREGROUND]);
-          if (!fg.isNull())
-            _last->setData(col, Qt::ForegroundRole, namedColor(fg.toString()));
-        }
+  if (DEBUG)
+    qDebug("%s::populateWorker() done", qPrintable(objectName()));
+  emit populated();
+}
 
-        if ((*_colRole)[col][COLROLE_BACKGROUND])
-        {
-          QVariant bg = pQuery.value((*_colRole)[col][COLROLE_BACKGROUND]);
-          if (!bg.isNull())
-            _last->setData(col, Qt::BackgroundRole, namedColor(bg.toString()));
-        }
+/*! Apply a keyed change set in place instead of repopulating the list.
 
-        if ((*_colRole)[col][COLROLE_TEXTALIGNMENT])
-        {
-          QVariant alignment = pQuery.value((*_colRole)[col][COLROLE_TEXTALIGNMENT]);
-          if (!alignment.isNull())
-            _last->setData(col, Qt::TextAlignmentRole, alignment);
-        }
-        else
-          _last->setData(col, Qt::TextAlignmentRole, headerItem()->textAlignment(col));
+    Each row of \a pUpserts has the columns populate() expects. A row whose
+    id, and altId if \a pUseAltId is set, matches an existing item replaces
+    that item's data; other rows are added as new items. The first item
+    with each id in \a pRemoved is deleted.
 
-        if ((*_colRole)[col][COLROLE_TOOLTIP])
-        {
-          QVariant tooltip = pQuery.value((*_colRole)[col][COLROLE_TOOLTIP]);
-          if (!tooltip.isNull() )
-            _last->setData(col, Qt::ToolTipRole, tooltip);
-        }
+    The selection, expanded rows, and scroll position are kept. Changed
+    top-level rows that no longer fit between their neighbors move to
+    their place in the current sort order, and running and total columns
+    are recalculated.
 
-        if ((*_colRole)[col][COLROLE_STATUSTIP])
-        {
-          QVariant statustip = pQuery.value((*_colRole)[col][COLROLE_STATUSTIP]);
-          if (!statustip.isNull())
-            _last->setData(col, Qt::StatusTipRole, statustip);
-        }
+    Returns false without changing anything if the list is still being
+    populated, was populated without column roles, a changed row has
+    a different xtindentrole than its item, or running subtotals are
+    shown in child rows, since the result then depends on rows outside
+    the change set. Callers should fall back to a full populate() in
+    that case.
+ */
+bool XTreeWidget::applyChanges(XSqlQuery pUpserts, const QList<int> &pRemoved, bool pUseAltId)
+{
+  if (_roles.size() <= 0 || _fetch || _workingTimer.isActive())
+  {
+    if (DEBUG)
+      qDebug("%s::applyChanges() cannot apply changes now", qPrintable(objectName()));
+    return false;
+  }
 
-        if ((*_colRole)[col][COLROLE_FONT])
-        {
-          QVariant font = pQuery.value((*_colRole)[col][COLROLE_FONT]);
-          if (!font.isNull())
-            _last->setData(col, Qt::FontRole, font);
-        }
+  if (_runningChildren)
+  {
+    if (DEBUG)
+      qDebug("%s::applyChanges() child rows have running subtotals", qPrintable(objectName()));
+    return false;
+  }
 
-        if ((*_colRole)[col][COLROLE_RUNNINGINIT])
-        {
-          QVariant runninginit = pQuery.value((*_colRole)[col][COLROLE_RUNNINGINIT]);
-          if (!runninginit.isNull())
-            _last->setData(col, Xt::RunningInitRole, runninginit);
-        }
+  int indentField = rootIsDecorated() ? pUpserts.record().indexOf("xtindentrole") : -1;
+  if (indentField > 0 && pUpserts.first())
+  {
+    do
+    {
+      int id     = pUpserts.value(0).toInt();
+      int altId  = (pUseAltId) ? pUpserts.value(1).toInt() : -1;
+      int indent = qMax(0, pUpserts.value(indentField).toInt());
+      XTreeWidgetItem *existing = pUseAltId ? itemWithId(id, altId) : itemWithId(id);
+      if ((existing && existing->data(0, Xt::IndentRole).toInt() != indent) ||
+          (indent > 0 && ! _running.isEmpty()))
+      {
+        if (DEBUG)
+          qDebug("%s::applyChanges() cannot place %d in the tree", qPrintable(objectName()), id);
+        return false;
+      }
+    } while (pUpserts.next());
+  }
 
-        if ((*_colRole)[col][COLROLE_ID])
-        {
-          QVariant id = pQuery.value((*_colRole)[col][COLROLE_ID]);
-          if (!id.isNull())
-            _last->setData(col, Xt::IdRole, id);
-        }
+  int scrollpos = verticalScrollBar()->value();
+  QList<QPair<int, int> > selected;
+  foreach (XTreeWidgetItem *item, selectedItems())
+    selected.append(qMakePair(item->id(), item->altId()));
 
-        if ((*_colRole)[col][COLROLE_RUNNING])
-        {
-          int set = pQuery.value((*_colRole)[col][COLROLE_RUNNING]).toInt();
-          _last->setData(col, Xt::RunningSetRole, set);
-          /* performance hack - populateCalculatedColumns will repeat this
-             but only redraw if necessary. redraw is much slower than recalc. */
-          if (! _subtotals->at(col)->contains(set))
-          {
-            if ((*_colRole)[col][COLROLE_RUNNINGINIT])
-              (*_subtotals)[col]->insert(set, pQuery.value((*_colRole)[col][COLROLE_RUNNINGINIT]).toDouble());
-            else
-              (*_subtotals)[col]->insert(set, 0.0);
-          }
-          (*(*_subtotals)[col])[set] += rawValue.toDouble();
-          _last->setData(col, Qt::DisplayRole,
-                         QLocale().toString((*_subtotals)[col]->value(set), 'f', scale));
-        }
+  // look up everything while the id index is still valid
+  QList<QPointer<XTreeWidgetItem> > removed;
+  foreach (int id, pRemoved)
+  {
+    XTreeWidgetItem *item = itemWithId(id);
+    if (item)
+      removed.append(item);
+  }
 
-        if ((*_colRole)[col][COLROLE_TOTAL])
-        {
-          _last->setData(col, Xt::TotalSetRole,
-                        pQuery.value((*_colRole)[col][COLROLE_TOTAL]).toInt());
-        }
+  QList<QPointer<XTreeWidgetItem> > changed;  // top-level items to re-sort
+  QList<XTreeWidgetItem*> topLevelItems;
+  if (pUpserts.first())
+  {
+    bool linear = _linear;
+    _linear = true;         // don't flash the progress dialog for a change set
+    preparePopulate(pUpserts.record(), pUpserts.size());
+    _linear = linear;
 
-        if (_rowRole[ROWROLE_DELETED])
-        {
-          if (DEBUG)
-            qDebug("%s::populate() found xtdeleterole, value = %s",
-                    qPrintable( objectName()),
-                    qPrintable( pQuery.value(_rowRole[ROWROLE_DELETED]).toString()));
-          if (pQuery.value(_rowRole[ROWROLE_DELETED]).toBool())
-          {
-            _last->setData(col,Xt::DeletedRole, QVariant(true));
-            QFont font = _last->font(col);
-            font.setStrikeOut(true);
-            _last->setFont(col, font);
-            _last->setTextColor(Qt::gray);
-          }
-        }
-        /*
-        if ((*_colRole)[col][COLROLE_KEY])
-          _last->setData(col, KeyRole, pQuery.value((*_colRole)[col][COLROLE_KEY]));
-        if ((*_colRole)[col][COLROLE_GROUPRUNNING])
-          _last->setData(col, GroupRunningRole, pQuery.value((*_colRole)[col][COLROLE_GROUPRUNNING]));
-        */
+    XTreeWidgetQueryRow row(pUpserts);
+    do
+    {
+      int id    = row.value(0).toInt();
+      int altId = (pUseAltId) ? row.value(1).toInt() : -1;
+      XTreeWidgetItem *existing = pUseAltId ? itemWithId(id, altId) : itemWithId(id);
+      if (! existing)
+      {
+        populateRow(row, pUseAltId, topLevelItems);
+        continue;
       }
 
-      if (allNull && indent > 0)
+      int indent = 0;
+      if (_rowRole[ROWROLE_INDENT])
+        indent = qMax(0, row.value(_rowRole[ROWROLE_INDENT]).toInt());
+
+      XTreeWidgetItem *fresh = new XTreeWidgetItem((XTreeWidgetItem*)0, id, altId);
+      if (_resultSet)
       {
-        qWarning("%s::populate() hiding indented row because it's empty",
-                 qPrintable(objectName()));
-        _last->setHidden(true);
+        fresh->_resultSet = _resultSet;
+        fresh->_resultRow = _resultSet->appendRow(row);
       }
-
-      if (qobject_cast<XTreeWidget*>(parentItem))
+      bool hidden = fillRowItem(fresh, row, indent);
+
+      // this copies the cells without going through setData()
+      existing->QTreeWidgetItem::operator=(*fresh);
+      existing->_resultSet = fresh->_resultSet;
+      existing->_resultRow = fresh->_resultRow;
+      existing->_compact   = fresh->_compact;
+      existing->_sortKey.clear();
+      delete fresh;
+      if (_rowRole[ROWROLE_HIDDEN] || indent > 0)
+        existing->setHidden(hidden);
+      existing->emitDataChanged();
+
+      if (! existing->QTreeWidgetItem::parent())
       {
-        //#13439 optimization - do not add items to 'this' until the very end
-        if(parentItem == this)
-          topLevelItems.append(_last);
-        else
-          qobject_cast<XTreeWidget*>(parentItem)->addTopLevelItem(_last);
+        // count this row and the ones after it again with its new values
+        truncateRunningTotals(QTreeWidget::indexOfTopLevelItem(existing));
+        changed.append(existing);
       }
-      else if (qobject_cast<XTreeWidgetItem*>(parentItem))
-        qobject_cast<XTreeWidgetItem*>(parentItem)->addChild(_last);
+    } while (pUpserts.next());
 
-    } while (pQuery.next());
+    this->addTopLevelItems(topLevelItems);
+    foreach (XTreeWidgetItem *item, topLevelItems)
+      changed.append(item);
+    cleanupAfterPopulate();
+  }
 
-  this->addTopLevelItems(topLevelItems); //#13439
+  // deleting a parent deletes its children, which clears their QPointers
+  foreach (QPointer<XTreeWidgetItem> item, removed)
+    delete item.data();
 
-  setId(pIndex);
-  emit valid(currentItem() != 0);
+  QString totalrole("totalrole");
+  for (int i = topLevelItemCount() - 1; i >= 0; i--)
+    if (topLevelItem(i)->data(0, Qt::UserRole).toString() == totalrole)
+      delete QTreeWidget::takeTopLevelItem(i);
+
+  int col = sortColumn();
+  if (col >= 0 && header()->isSortIndicatorShown() &&
+      headerItem()->data(col, Qt::UserRole).toString() != "xtrunningrole")
+  {
+    Qt::SortOrder order = header()->sortIndicatorOrder();
+
+    /* the untouched rows are still in order, so only changed rows out of
+       order with a neighbor have to move. taking one out gives the rows
+       on either side new neighbors, so check them again.
+     */
+    QSet<XTreeWidgetItem *>  unchecked;
+    QList<XTreeWidgetItem *> check;
+    for (int i = changed.size() - 1; i >= 0; i--)
+    {
+      if (changed.at(i) && ! unchecked.contains(changed.at(i)))
+      {
+        unchecked.insert(changed.at(i));
+        check.append(changed.at(i));
+      }
+    }
 
-  // clean up. we won't reach here until the query is done, even if ! _linear
-  {
-    _workingTimer.stop();
+    QList<XTreeWidgetItem *> moving;
+    QSet<XTreeWidgetItem *>  expanded;
+    while (! check.isEmpty())
+    {
+      XTreeWidgetItem *item = check.takeLast();
+      int idx = QTreeWidget::indexOfTopLevelItem(item);
+      if (idx < 0 || isInSortOrder(this, idx, col, order))
+        continue;
+
+      if (item->isExpanded())
+        expanded.insert(item);
+      QTreeWidget::takeTopLevelItem(idx);
+      unchecked.remove(item);
+      moving.append(item);
+      if (idx > 0 && unchecked.contains(topLevelItem(idx - 1)))
+        check.append(topLevelItem(idx - 1));
+      if (idx < topLevelItemCount() && unchecked.contains(topLevelItem(idx)))
+        check.append(topLevelItem(idx));
+    }
 
-    if (_workingParams.size())
-      _workingParams.takeFirst();
+    // merge the moving rows back in from the bottom up, after any equal
+    // rows as the stable sort in sortItems() would. each search stops at
+    // the row inserted before it, so the positions only shrink.
+    QVector<XTreeWidgetSortKey> keys(moving.size());
+    QVector<int>                sorted(moving.size());
+    for (int i = 0; i < moving.size(); i++)
+    {
+      sorted[i] = i;
+      extractSortKey(moving.at(i)->data(col, Xt::RawRole), keys[i]);
+    }
+    QList<Qt::SortOrder> orders;
+    orders << order;
+    std::stable_sort(sorted.begin(), sorted.end(), XTreeWidgetSortCompare(keys, orders));
 
-    cleanupAfterPopulate();
+    int hi = topLevelItemCount();
+    for (int i = sorted.size() - 1; i >= 0; i--)
+    {
+      XTreeWidgetItem *item = moving.at(sorted.at(i));
+      const XTreeWidgetSortKey &key = keys.at(sorted.at(i));
+      int lo = 0;
+      while (lo < hi)
+      {
+        int mid = (lo + hi) / 2;
+        XTreeWidgetSortKey other;
+        extractSortKey(topLevelItem(mid)->data(col, Xt::RawRole), other);
+        bool before = (order == Qt::AscendingOrder) ? sortKeyLessThan(key, other)
+                                                    : sortKeyLessThan(other, key);
+        if (before)
+          hi = mid;
+        else
+          lo = mid + 1;
+      }
+      QTreeWidget::insertTopLevelItem(lo, item);
+      item->setExpanded(expanded.contains(item));
+    }
+  }
 
-    populateCalculatedColumns();
-    if (sortColumn() >= 0 && header()->isSortIndicatorShown())
-      sortItems(sortColumn(), header()->sortIndicatorOrder());
+  populateCalculatedColumns();
 
-    if (DEBUG)
-      qDebug("%s::populateWorker() done", qPrintable(objectName()));
-    emit populated();
+  for (int i = 0; i < selected.size(); i++)
+  {
+    XTreeWidgetItem *item = itemWithId(selected.at(i).first, selected.at(i).second);
+    if (item && ! item->isSelected())
+      item->setSelected(true);
   }
+  verticalScrollBar()->setValue(scrollpos);
 
-  if (_linear)
-    qApp->restoreOverrideCursor();
+  if (DEBUG)
+    qDebug("%s::applyChanges() %d changed, %d removed", qPrintable(objectName()),
+           changed.size(), removed.size());
+  return true;
+}
+
+/*! Apply \a pQuery as a change set with no deletions. \sa applyChanges() */
+bool XTreeWidget::upsertRows(XSqlQuery pQuery, bool pUseAltId)
+{
+  return applyChanges(pQuery, QList<int>(), pUseAltId);
+}
+
+/*! Delete the items with the given ids in place. \sa applyChanges() */
+bool XTreeWidget::removeRows(const QList<int> &pIds)
+{
+  return applyChanges(XSqlQuery(), pIds);
 }
 
 void XTreeWidget::cleanupAfterPopulate()
@@ -797,6 +1550,12 @@ void XTreeWidget::cleanupAfterPopulate()
     delete _colIdx;
   _colIdx = 0;
 
+  if (_plan)
+    delete _plan;
+  _plan = 0;
+
+  _resultSet.clear();
+
   _fieldCount = 0;
 }
 
@@ -974,58 +1733,31 @@ QString XTreeWidgetItem::toString() const
 
 bool XTreeWidgetItem::operator<(const XTreeWidgetItem &other) const
 {
-  QVariant  v1         = data(treeWidget()->sortColumn(), Xt::RawRole);
-  QVariant  v2         = other.data(other.treeWidget()->sortColumn(), Xt::RawRole);
-
-  bool      returnVal  = false;
-  switch (v1.type())
-  {
-    case QVariant::Bool:
-      returnVal = (!v1.toBool() && v1 != v2);
-      break;
-
-    case QVariant::Date:
-      returnVal = (v1.toDate() < v2.toDate());
-      break;
-
-    case QVariant::DateTime:
-      returnVal = (v1.toDateTime() < v2.toDateTime());
-      break;
-
-    case QVariant::Double:
-      returnVal = (v1.toDouble() < v2.toDouble());
-      break;
-
-    case QVariant::Int:
-      returnVal = (v1.toInt() < v2.toInt());
-      break;
-
-    case QVariant::LongLong:
-      returnVal = (v1.toLongLong() < v2.toLongLong());
-      break;
-
-    case QVariant::String:
-      bool ok;
-      if (v1.toString().toDouble() == 0.0 && v2.toDouble() == 0.0)
-        returnVal = (v1.toString() < v2.toString());
-      else if (v1.toString().toDouble() == 0.0 && v2.toDouble(&ok)) //v1 is string, v2 is number
-        returnVal = false; //the number should always be treated as greater than a string
-      else if (v1.toDouble(&ok) && v2.toString().toDouble() == 0.0)
-        returnVal = true;
-      else
-        returnVal = (v1.toDouble() < v2.toDouble());
-      break;
-
-    default:
-      returnVal = false;
-  }
+  bool returnVal = sortKeyLessThan(sortKey(treeWidget()->sortColumn()),
+                                   other.sortKey(other.treeWidget()->sortColumn()));
 
   if (DEBUG)
     qDebug("returning %d for %s < %s", returnVal,
-           qPrintable(v1.toString()), qPrintable(v2.toString()));
+           qPrintable(data(treeWidget()->sortColumn(), Xt::RawRole).toString()),
+           qPrintable(other.data(other.treeWidget()->sortColumn(), Xt::RawRole).toString()));
   return returnVal;
 }
 
+/* QTreeWidget's own sort calls operator< O(n log n) times, so keep the
+   key of the sort column until that column's raw value changes
+ */
+const XTreeWidgetSortKey &XTreeWidgetItem::sortKey(int column) const
+{
+  if (! _sortKey || _sortKeyColumn != column)
+  {
+    if (! _sortKey)
+      _sortKey = QSharedPointer<XTreeWidgetSortKey>(new XTreeWidgetSortKey);
+    extractSortKey(data(column, Xt::RawRole), *_sortKey);
+    _sortKeyColumn = column;
+  }
+  return *_sortKey;
+}
+
 bool XTreeWidgetItem::operator==(const XTreeWidgetItem &other) const
 {
   QVariant  v1         = data(treeWidget()->sortColumn(), Xt::RawRole);
@@ -1083,8 +1815,6 @@ bool XTreeWidgetItem::operator>(const XTreeWidgetItem &other) const
 */
 void XTreeWidget::sortItems(int column, Qt::SortOrder order)
 {
-  int previd = id();
-
   // if old style then maintain backwards compatibility
   if (_roles.size() <= 0)
   {
@@ -1098,112 +1828,66 @@ void XTreeWidget::sortItems(int column, Qt::SortOrder order)
 
   header()->setSortIndicator(column, order);
 
-  // simple insertion sort using binary search to find the right insertion pt
+  sortItems(QList<int>() << column, QList<Qt::SortOrder>() << order);
+}
+
+/*!
+  Sorts the top level items by each of \a columns in turn, using the
+  matching entry in \a orders for the direction. Rows that compare equal
+  on every column keep their current relative order, and child rows move
+  with their parents. Unlike sortItems(int, Qt::SortOrder) this does not
+  change the header's sort indicator.
+*/
+void XTreeWidget::sortItems(const QList<int> &columns, const QList<Qt::SortOrder> &orders)
+{
+  if (columns.isEmpty() || columns.size() != orders.size())
+    return;
+
+  int previd = id();
+
+  QList<QTreeWidgetItem *> items = QTreeWidget::invisibleRootItem()->takeChildren();
+  QList<QTreeWidgetItem *> rows;
+  rows.reserve(items.size());
+
   QString totalrole("totalrole");
-  int     itemcount      = topLevelItemCount();
-  XTreeWidgetItem *prev  = dynamic_cast<XTreeWidgetItem *>(topLevelItem(0));
-  for (int i = 1; i < itemcount; i++)
+  for (int i = 0; i < items.size(); i++)
   {
-    XTreeWidgetItem *item = dynamic_cast<XTreeWidgetItem *>(topLevelItem(i));
+    XTreeWidgetItem *item = dynamic_cast<XTreeWidgetItem *>(items.at(i));
     if (!item)
     {
       qWarning("removing a non-XTreWidgetItem from an XTreeWidget");
-      takeTopLevelItem(i);
-      itemcount--;
-      i--;
+      delete items.at(i);
     }
     else if (item->data(0, Qt::UserRole).toString() == totalrole)
     {
       if (DEBUG)
         qDebug("sortItems() removing row %d because it's a totalrole", i);
-      takeTopLevelItem(i);
-      itemcount--;
-      i--;
-    }
-    else if (*item < *prev && order == Qt::AscendingOrder)
-    {
-      int left   = 0;
-      int right  = i;
-      int middle = 0;
-      XTreeWidgetItem *test = 0;
-      while (left <= right)
-      {
-        middle = (left + right) / 2;
-        test   = static_cast<XTreeWidgetItem *>(topLevelItem(middle));
-        if (*test == *item)
-          break;
-        else if (*test < *item)
-        {
-          if (*item < *(static_cast<XTreeWidgetItem *>(topLevelItem(middle + 1))))
-            break;
-          else
-            left = middle + 1;
-        }
-        else
-          right = middle - 1;
-      }
-      // can't call takeTopLevelItem() until after < and == are done
-      if (*item < *test || *item == *test)
-      {
-        if (DEBUG)
-          qDebug("<= so moving %d to %d", i, middle);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle, item);
-      }
-      else
-      {
-        if (DEBUG)
-          qDebug("> so moving %d to %d", i, middle + 1);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle + 1, item);
-      }
-    }
-    else if (*item == *prev)
-    {
-      ; // nothing to do - make the > case easier to write
-    }
-    else if (!(*item < *prev) && order == Qt::DescendingOrder)
-    {
-      int left   = 0;
-      int right  = i;
-      int middle = 0;
-      XTreeWidgetItem *test = 0;
-      while (left <= right)
-      {
-        middle = (left + right) / 2;
-        test   = static_cast<XTreeWidgetItem *>(topLevelItem(middle));
-        if (*test == *item)
-          break;
-        else if (!(*test < *item))
-        {
-          if (!(*item < *(static_cast<XTreeWidgetItem *>(topLevelItem(middle + 1)))))
-            break;
-          else
-            left = middle + 1;
-        }
-        else
-          right = middle - 1;
-      }
-      // can't call takeTopLevelItem() until after < and == are done
-      if (!(*item < *test) || *item == *test)
-      {
-        if (DEBUG)
-          qDebug(">= so moving %d to %d", i, middle);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle, item);
-      }
-      else
-      {
-        if (DEBUG)
-          qDebug("< so moving %d to %d", i, middle + 1);
-        takeTopLevelItem(i);
-        insertTopLevelItem(middle + 1, item);
-      }
+      delete item;
     }
-    // can't reuse item because the thing in position i may have changed
-    prev = static_cast<XTreeWidgetItem *>(topLevelItem(i));
+    else
+      rows.append(item);
   }
 
+  int keycnt = columns.size();
+  QVector<XTreeWidgetSortKey> keys(rows.size() * keycnt);
+  QVector<int>                order(rows.size());
+  for (int row = 0; row < rows.size(); row++)
+  {
+    order[row] = row;
+    for (int i = 0; i < keycnt; i++)
+      extractSortKey(rows.at(row)->data(columns.at(i), Xt::RawRole),
+                     keys[row * keycnt + i]);
+  }
+
+  std::stable_sort(order.begin(), order.end(),
+                   XTreeWidgetSortCompare(keys, orders));
+
+  QList<QTreeWidgetItem *> sorted;
+  sorted.reserve(rows.size());
+  for (int row = 0; row < order.size(); row++)
+    sorted.append(rows.at(order.at(row)));
+  QTreeWidget::addTopLevelItems(sorted);
+
   populateCalculatedColumns();
 
   setId(previd);
@@ -1212,34 +1896,33 @@ void XTreeWidget::sortItems(int column, Qt::SortOrder order)
 
 void XTreeWidget::populateCalculatedColumns()
 {
-  QMap<int, QMap<int, double> > totals; // <col <totalset, subtotal> >
-  QMap<int, int> scales;                // keep scale for the col, not col[totalset]
+  populateCalculatedColumns(0);
+}
+
+/* add the top-level rows from row on to the column totals. the totals
+   kept by the last pass are reused, so that pass must have counted
+   exactly the rows before this one.
+ */
+void XTreeWidget::populateCalculatedColumns(int from)
+{
+  if (from <= 0)
+  {
+    _totals.clear();
+    _totalScales.clear();
+  }
+  QMap<int, QMap<int, double> > &totals = _totals;  // <col <totalset, subtotal> >
+  QMap<int, int> &scales = _totalScales;            // keep scale for the col, not col[totalset]
+  QLocale        locale;
   for (int col = 0; topLevelItem(0) &&
        col < topLevelItem(0)->columnCount(); col++)
   {
-    if (headerItem()->data(col, Qt::UserRole).toString() == "xtrunningrole")
-    {
-      QMap<int, double> subtotals;
-      // assume that Xt::RunningSetRole exists if xtrunningrole exists
-      for (int row = 0; row < topLevelItemCount(); row++)
-      {
-        int set = topLevelItem(row)->data(col, Xt::RunningSetRole).toInt();
-        if (!subtotals.contains(set))
-          subtotals[set] = topLevelItem(row)->data(col, Xt::RunningInitRole).toDouble();
-        subtotals[set] += topLevelItem(row)->data(col, Xt::RawRole).toDouble();
-
-        // setData apparently knows if the value hasn't changed
-        topLevelItem(row)->setData(col, Qt::DisplayRole,
-                                   QLocale().toString(subtotals[set], 'f',
-                                                      topLevelItem(row)->data(col, Xt::ScaleRole).toInt()));
-      }
-    }
-    else if (headerItem()->data(col, Qt::UserRole).toString() == "xttotalrole")
+    // xtrunningrole columns are handled by buildRunningTotals() below
+    if (headerItem()->data(col, Qt::UserRole).toString() == "xttotalrole")
     {
-      QMap<int, double> totalset;
-      int colscale = -99999;
+      QMap<int, double> totalset = totals.value(col);
+      int colscale = scales.value(col, -99999);
       // assume that Xt::TotalSetRole exists if xttotalrole exists
-      for (int row = 0; row < topLevelItemCount(); row++)
+      for (int row = qMax(0, from); row < topLevelItemCount(); row++)
       {
         int set = topLevelItem(row)->data(col, Xt::TotalSetRole).toInt();
         if (!totalset.contains(set))
@@ -1253,24 +1936,309 @@ void XTreeWidget::populateCalculatedColumns()
     }
   }
 
-  // punt: for now only report values of totalset[0] for each totaled col
-  // TODO: figure out how to handle multiple totalsets
-  if (totals.size() > 0)
+  // punt: for now only report values of totalset[0] for each totaled col
+  // TODO: figure out how to handle multiple totalsets
+  if (totals.size() > 0)
+  {
+    XTreeWidgetItem *last = new XTreeWidgetItem(this, -1, -1,
+                                                (totals.size() == 1) ? tr("Total") : tr("Totals"));
+    last->setData(0, Qt::UserRole, "totalrole");
+    QMapIterator<int, QMap<int, double> > it(totals);
+    while (it.hasNext())
+    {
+      it.next();
+      last->setData(it.key(), Qt::DisplayRole,
+                    locale.toString(it.value().value(0), 'f',
+                                       scales.value(it.key())));
+    }
+  }
+
+  buildRunningTotals();
+  if (! _running.isEmpty())
+    viewport()->update();
+}
+
+/* bring the running subtotals of every xtrunningrole column up to date,
+   starting over only if the running columns changed. trees without
+   running columns leave _running empty, which XTreeWidgetItem::data()
+   checks before asking for a subtotal.
+ */
+void XTreeWidget::buildRunningTotals() const
+{
+  QList<int> columns;
+  for (int col = 0; col < QTreeWidget::columnCount(); col++)
+    if (headerItem()->data(col, Qt::UserRole).toString() == "xtrunningrole")
+      columns.append(col);
+
+  if (columns != _running.keys())
+  {
+    _running.clear();
+    _runningRows = 0;
+    foreach (int col, columns)
+      _running.insert(col, XTreeWidgetRunningTotal());
+  }
+
+  appendRunningTotals();
+}
+
+/* add the top-level rows after the last one already counted, which is
+   all of them after a sort but only the new or moved tail otherwise.
+ */
+void XTreeWidget::appendRunningTotals() const
+{
+  if (_running.isEmpty())
+  {
+    _runningRows = topLevelItemCount();
+    return;
+  }
+
+  QString totalrole("totalrole");
+  for (int row = _runningRows; row < topLevelItemCount(); row++)
+  {
+    XTreeWidgetItem *item = topLevelItem(row);
+    item->_runningRow = -1;
+    if (item->data(0, Qt::UserRole).toString() == totalrole)
+      continue;
+
+    // assume that Xt::RunningSetRole exists if xtrunningrole exists
+    for (QMap<int, XTreeWidgetRunningTotal>::iterator it = _running.begin();
+         it != _running.end(); ++it)
+      item->_runningRow = it.value().append(item->data(it.key(), Xt::RunningSetRole).toInt(),
+                                            item->data(it.key(), Xt::RunningInitRole).toDouble(),
+                                            item->data(it.key(), Xt::RawRole).toDouble());
+  }
+  _runningRows = topLevelItemCount();
+}
+
+/* forget the subtotals from top-level row on. the rows before it have not
+   moved, so the last counted one tells how many running rows to keep.
+ */
+void XTreeWidget::truncateRunningTotals(int row)
+{
+  if (_running.isEmpty() || row >= _runningRows)
+    return;
+
+  int keep = 0;
+  for (int i = row - 1; i >= 0; i--)
+  {
+    if (topLevelItem(i)->_runningRow >= 0)
+    {
+      keep = topLevelItem(i)->_runningRow + 1;
+      break;
+    }
+  }
+
+  for (QMap<int, XTreeWidgetRunningTotal>::iterator it = _running.begin();
+       it != _running.end(); ++it)
+    it.value().truncate(keep);
+  _runningRows = row;
+}
+
+/* the formatted running subtotal of top-level item in column,
+   or an invalid QVariant if column doesn't have one. child rows
+   get theirs as display text from fillRowItem() instead.
+ */
+QVariant XTreeWidget::runningTotal(const XTreeWidgetItem *item, int column) const
+{
+  if (_runningRows < topLevelItemCount())
+    appendRunningTotals();
+
+  QMap<int, XTreeWidgetRunningTotal>::const_iterator it = _running.constFind(column);
+  if (it == _running.constEnd() || item->_runningRow < 0 ||
+      item->QTreeWidgetItem::parent() || item->_runningRow >= it.value().rowCount())
+    return QVariant();
+
+  return QLocale().toString(it.value().value(item->_runningRow), 'f',
+                            item->data(column, Xt::ScaleRole).toInt());
+}
+
+void XTreeWidget::sInvalidateRunningTotals()
+{
+  truncateRunningTotals(0);
+}
+
+void XTreeWidget::sRunningRowsChanged(const QModelIndex &parent, int first, int last)
+{
+  Q_UNUSED(last);
+  if (! parent.isValid())
+    truncateRunningTotals(first);
+}
+
+/*! Keep a search index over the top-level text of \a pColumns so that
+    sSearch() and findFirstItem() don't have to scan every row.
+    \a pMatch is Qt::MatchStartsWith if only prefix searches are needed,
+    which makes the index smaller, or Qt::MatchContains for both kinds.
+
+    The index is built on a background thread shortly after the rows stop
+    changing. Until it is ready, searches fall back to scanning the rows.
+    An empty list turns the index off, which is the default.
+ */
+void XTreeWidget::setSearchColumns(const QList<int> &pColumns, Qt::MatchFlags pMatch)
+{
+  int mode = XTreeWidgetSearchIndex::StartsWith;
+  if ((pMatch & 0x0F) == Qt::MatchContains)
+    mode |= XTreeWidgetSearchIndex::Contains;
+
+  if (pColumns == _searchColumns && mode == _searchMode)
+    return;
+
+  _searchColumns = pColumns;
+  _searchMode    = mode;
+  sInvalidateSearchIndex();
+  if (_searchColumns.isEmpty())
+    _searchIndexTimer.stop();
+}
+
+void XTreeWidget::sInvalidateSearchIndex()
+{
+  delete _searchIndex;
+  _searchIndex = 0;
+
+  if (_searchIndexBuild)
+  {
+    // let a stale build finish on its own and throw its result away
+    disconnect(_searchIndexBuild, SIGNAL(finished()), this, SLOT(sSearchIndexBuilt()));
+    connect(_searchIndexBuild, SIGNAL(finished()), _searchIndexBuild, SLOT(deleteLater()));
+    _searchIndexBuild = 0;
+  }
+
+  if (! _searchColumns.isEmpty())
+    _searchIndexTimer.start();
+}
+
+void XTreeWidget::sBuildSearchIndex()
+{
+  if (_searchColumns.isEmpty())
+    return;
+
+  // rows are still arriving, so wait for them to settle
+  if (_fetch || _workingTimer.isActive())
+  {
+    _searchIndexTimer.start();
+    return;
+  }
+
+  /* only collect values here; formatting lazily populated cells is left
+     to the worker. running totals and values set on an item win over the
+     result set, as in XTreeWidgetItem::data().
+   */
+  int rows = topLevelItemCount();
+  XTreeWidgetSearchSnapshot snapshot;
+  snapshot.columns = _searchColumns;
+  snapshot.values.resize(_searchColumns.size());
+  for (int i = 0; i < _searchColumns.size(); i++)
+    snapshot.values[i].resize(rows);
+  snapshot.resultSet.resize(rows);
+  snapshot.resultRow.resize(rows);
+
+  QHash<XTreeWidgetResultSet *, int> sets;
+  for (int row = 0; row < rows; row++)
+  {
+    XTreeWidgetItem *item = topLevelItem(row);
+    int set = -1;
+    if (item->_resultSet)
+    {
+      set = sets.value(item->_resultSet.data(), -1);
+      if (set < 0)
+      {
+        set = snapshot.resultSets.size();
+        sets.insert(item->_resultSet.data(), set);
+        snapshot.resultSets.append(QSharedPointer<XTreeWidgetResultSet>(
+                                     new XTreeWidgetResultSet(*item->_resultSet)));
+      }
+    }
+    snapshot.resultSet[row] = set;
+    snapshot.resultRow[row] = item->_resultRow;
+
+    for (int i = 0; i < _searchColumns.size(); i++)
+    {
+      int      col = _searchColumns.at(i);
+      QVariant value;
+      if (_running.contains(col))
+        value = runningTotal(item, col);
+      if (! value.isValid())
+        value = item->QTreeWidgetItem::data(col, Qt::DisplayRole);
+      if (! value.isValid() && ! item->_resultSet && item->_compact)
+        value = item->columnDefault(col, Qt::DisplayRole);
+      if (! value.isValid() && ! item->_resultSet)
+        value = QString();
+      snapshot.values[i][row] = value;
+    }
+  }
+
+  _searchIndexBuild = new XTreeWidgetSearchIndexThread(snapshot, _searchMode, this);
+  connect(_searchIndexBuild, SIGNAL(finished()), this, SLOT(sSearchIndexBuilt()));
+  _searchIndexBuild->start(QThread::LowPriority);
+}
+
+/* keep the index in step with top-level cells that change in place
+   instead of building it again; only the changed rows are formatted
+ */
+void XTreeWidget::sSearchDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+  if (_searchColumns.isEmpty() || topLeft.parent().isValid())
+    return;
+
+  if (_searchIndexBuild || ! _searchIndex ||
+      _searchIndex->rowCount() != topLevelItemCount())
+  {
+    sInvalidateSearchIndex();  // a build in progress has the old text
+    return;
+  }
+
+  for (int row = topLeft.row(); row <= bottomRight.row(); row++)
   {
-    XTreeWidgetItem *last = new XTreeWidgetItem(this, -1, -1,
-                                                (totals.size() == 1) ? tr("Total") : tr("Totals"));
-    last->setData(0, Qt::UserRole, "totalrole");
-    QMapIterator<int, QMap<int, double> > it(totals);
-    while (it.hasNext())
+    QTreeWidgetItem *item = QTreeWidget::topLevelItem(row);
+    if (! item)
+      continue;
+    foreach (int col, _searchColumns)
     {
-      it.next();
-      last->setData(it.key(), Qt::DisplayRole,
-                    QLocale().toString(it.value().value(0), 'f',
-                                       scales.value(it.key())));
+      if (col >= topLeft.column() && col <= bottomRight.column())
+        _searchIndex->setText(col, row, item->text(col));
     }
   }
 }
 
+void XTreeWidget::sSearchIndexBuilt()
+{
+  if (! _searchIndexBuild || sender() != _searchIndexBuild)
+    return;
+
+  delete _searchIndex;
+  _searchIndex = _searchIndexBuild->takeIndex();
+  _searchIndexBuild->deleteLater();
+  _searchIndexBuild = 0;
+
+  if (DEBUG)
+    qDebug("%s::sSearchIndexBuilt() indexed %d rows",
+           qPrintable(objectName()), _searchIndex->rowCount());
+}
+
+/* the first top-level row whose text in column starts with or contains
+   text, ignoring case. uses the search index if it is current.
+ */
+int XTreeWidget::findFirstRow(const QString &text, int matchType, int column) const
+{
+  if (_searchIndex && _searchIndex->hasColumn(column) &&
+      _searchIndex->rowCount() == topLevelItemCount())
+  {
+    if (matchType == Qt::MatchStartsWith)
+      return _searchIndex->firstStartingWith(column, text);
+    if ((_searchIndex->mode() & XTreeWidgetSearchIndex::Contains) || text.size() < 3)
+      return _searchIndex->firstContaining(column, text);
+  }
+
+  int rows = topLevelItemCount();
+  for (int row = 0; row < rows; row++)
+  {
+    QString value = QTreeWidget::topLevelItem(row)->text(column);
+    if (matchType == Qt::MatchStartsWith ? value.startsWith(text, Qt::CaseInsensitive)
+                                         : value.contains(text, Qt::CaseInsensitive))
+      return row;
+  }
+  return -1;
+}
+
 int XTreeWidget::id() const
 {
   QList<XTreeWidgetItem *> items = selectedItems();
@@ -1310,6 +2278,7 @@ int XTreeWidget::altId() const
 /*!
   Selects a row with a matching value \a pId on the first column in the result set.
   If \a pClear is true then any previous selections are cleared.
+  Hidden rows are skipped.
 */
 void XTreeWidget::setId(int pId, bool pClear)
 {
@@ -1322,18 +2291,7 @@ void XTreeWidget::setId(int pId, bool pClear)
   else
     flag = QItemSelectionModel::Select;
 
-  XTreeWidgetItem *item  = (XTreeWidgetItem *)topLevelItem(0);
-  QTreeWidgetItem *found = 0;
-  while (item)
-  {
-    if (item && item->id() == pId)
-      found = item;
-    else if (item && item->childCount() > 0)
-      found = searchChildren(item, pId);
-    if (found)
-      break;
-    item = (XTreeWidgetItem *)itemBelow(item);
-  }
+  XTreeWidgetItem *found = shownItemWithId(pId, -1, false);
   if (found)
   {
     scrollToItem(found);
@@ -1344,30 +2302,10 @@ void XTreeWidget::setId(int pId, bool pClear)
   }
 }
 
-// This is a static local function to help searching children recursively
-QTreeWidgetItem *searchChildren(XTreeWidgetItem *parent, int pId)
-{
-  if (!parent)
-    return 0;
-
-  XTreeWidgetItem *item  = 0;
-  QTreeWidgetItem *found = 0;
-  for (int i = 0; i < parent->childCount(); ++i)
-  {
-    item = (XTreeWidgetItem *)parent->child(i);
-    if (item && item->id() == pId)
-      found = item;
-    else if (item && item->childCount() > 0)
-      found = searchChildren(item, pId);
-    if (found)
-      return found;
-  }
-  return 0;
-}
-
 /*!
 Selects a row with a matching values \a pId and \a pAltId on the first and second columns
 respectively in the result set. If \a pClear is true then any previous selections are cleared.
+Hidden rows are skipped.
 */
 void XTreeWidget::setId(int pId, int pAltId, bool pClear)
 {
@@ -1380,16 +2318,137 @@ void XTreeWidget::setId(int pId, int pAltId, bool pClear)
   else
     flag = QItemSelectionModel::Select;
 
-  for (QModelIndex i = indexFromItem(topLevelItem(0)); i.isValid(); i = indexBelow(i))
+  XTreeWidgetItem *found = shownItemWithId(pId, pAltId, true);
+  if (found)
+    selectionModel()->setCurrentIndex(indexFromItem(found),
+                                      flag |
+                                      QItemSelectionModel::Rows);
+}
+
+/*!
+  Returns the first item in the tree, including children, whose id
+  is \a pId, or 0 if there is none.
+  The lookup uses a hash index that is kept in step with rows as they
+  are inserted and rebuilt after rows are removed or reordered.
+  Unlike setId(), this also finds hidden rows.
+*/
+XTreeWidgetItem *XTreeWidget::itemWithId(int pId) const
+{
+  if (_idIndexDirty)
+    buildIdIndex();
+
+  XTreeWidgetItem *item = _idIndex.value(pId, 0);
+  if (item && item->id() != pId)       // paranoia - should never happen
   {
-    XTreeWidgetItem *item = (XTreeWidgetItem *)itemFromIndex(i);
-    if (item && item->id() == pId && item->altId() == pAltId)
-    {
-      selectionModel()->setCurrentIndex(i,
-                                        flag |
-                                        QItemSelectionModel::Rows);
-      return;
-    }
+    buildIdIndex();
+    item = _idIndex.value(pId, 0);
+  }
+  return item;
+}
+
+/*!
+  Returns the first item in the tree, including children, whose id
+  is \a pId and whose altId is \a pAltId, or 0 if there is none.
+*/
+XTreeWidgetItem *XTreeWidget::itemWithId(int pId, int pAltId) const
+{
+  if (_idIndexDirty)
+    buildIdIndex();
+
+  XTreeWidgetItem *item = _idAltIndex.value(qMakePair(pId, pAltId), 0);
+  if (item && (item->id() != pId || item->altId() != pAltId))
+  {
+    buildIdIndex();
+    item = _idAltIndex.value(qMakePair(pId, pAltId), 0);
+  }
+  return item;
+}
+
+static bool isShown(QTreeWidgetItem *item)
+{
+  for ( ; item; item = item->parent())
+    if (item->isHidden())
+      return false;
+  return true;
+}
+
+/* the first item with pId, and pAltId if pUseAltId, that isn't hidden
+   itself or under a hidden parent. the index only holds the first item
+   for each id, so if that one is hidden this walks the tree instead.
+ */
+XTreeWidgetItem *XTreeWidget::shownItemWithId(int pId, int pAltId, bool pUseAltId) const
+{
+  XTreeWidgetItem *item = pUseAltId ? itemWithId(pId, pAltId) : itemWithId(pId);
+  if (! item || isShown(item))
+    return item;
+
+  for (QTreeWidgetItemIterator it(const_cast<XTreeWidget *>(this)); *it; ++it)
+  {
+    item = dynamic_cast<XTreeWidgetItem *>(*it);
+    if (item && item->id() == pId && (! pUseAltId || item->altId() == pAltId) &&
+        isShown(item))
+      return item;
+  }
+  return 0;
+}
+
+/* add item and its children to the id indexes.
+   returns false if that could change which item is found first for an id,
+   since the indexes must then be rebuilt in tree order.
+ */
+bool XTreeWidget::indexItem(XTreeWidgetItem *item) const
+{
+  if (!item)
+    return true;
+
+  QPair<int, int> key = qMakePair(item->id(), item->altId());
+  if (_idIndex.contains(item->id()) || _idAltIndex.contains(key))
+    return false;
+
+  _idIndex.insert(item->id(), item);
+  _idAltIndex.insert(key, item);
+
+  for (int i = 0; i < item->childCount(); i++)
+    if (! indexItem(dynamic_cast<XTreeWidgetItem *>(item->QTreeWidgetItem::child(i))))
+      return false;
+
+  return true;
+}
+
+void XTreeWidget::buildIdIndex() const
+{
+  _idIndex.clear();
+  _idAltIndex.clear();
+
+  for (QTreeWidgetItemIterator it(const_cast<XTreeWidget *>(this)); *it; ++it)
+  {
+    XTreeWidgetItem *item = dynamic_cast<XTreeWidgetItem *>(*it);
+    if (! item)
+      continue;
+    if (! _idIndex.contains(item->id()))
+      _idIndex.insert(item->id(), item);
+    QPair<int, int> key = qMakePair(item->id(), item->altId());
+    if (! _idAltIndex.contains(key))
+      _idAltIndex.insert(key, item);
+  }
+  _idIndexDirty = false;
+}
+
+void XTreeWidget::sInvalidateIdIndex()
+{
+  _idIndexDirty = true;
+}
+
+void XTreeWidget::sRowsInserted(const QModelIndex &parent, int first, int last)
+{
+  if (_idIndexDirty)
+    return;
+
+  for (int row = first; row <= last && ! _idIndexDirty; row++)
+  {
+    XTreeWidgetItem *item = dynamic_cast<XTreeWidgetItem *>(itemFromIndex(model()->index(row, 0, parent)));
+    if (! indexItem(item))
+      _idIndexDirty = true;
   }
 }
 
@@ -1411,22 +2470,32 @@ void XTreeWidget::setPopulateLinear(bool alwaysLinear)
   _alwaysLinear = alwaysLinear;
 }
 
+/*!
+  When \a lazy is true, populate() keeps the query results in a compact
+  columnar XTreeWidgetResultSet instead of storing the display text,
+  alignment, colors and other roles in every cell. Those are computed by
+  XTreeWidgetItem::data() when something asks for them, which for a large
+  result is usually only the rows on the screen.
+*/
+bool XTreeWidget::populateLazy() const { return _lazy; }
+void XTreeWidget::setPopulateLazy(bool lazy)
+{
+  _lazy = lazy;
+}
+
 void XTreeWidget::clear()
 {
   if (DEBUG)
     qDebug("%s::clear()", qPrintable(objectName()));
+  sCancelFetch();
+  if (_pager && ! _pager->isFetching())
+    _pager->close();
   if (! _workingTimer.isActive())
     _workingParams.clear();
-  if (_subtotals)
-  {
-    for (int i = 0; i < _subtotals->size(); i++)
-    {
-      delete (*_subtotals)[i];
-      _subtotals->replace(i, 0);
-    }
-    delete _subtotals;
-    _subtotals = 0;
-  }
+  _running.clear();
+  _runningRows = 0;
+  _childSubtotals.clear();
+  _runningChildren = false;
   emit valid(false);
   _savedId = false; // was -1;
 
@@ -1583,15 +2652,31 @@ void XTreeWidget::sExport()
     xtsettingsSetValue(_settingsName + "/exportPath", fi.path());
     writer.setFileName(fi.filePath());
 
-    if (fi.suffix() == "txt")
-    {
-      doc->setPlainText(toTxt());
-      writer.setFormat("plaintext");
-    }
-    else if (fi.suffix() == "csv")
+    if (fi.suffix() == "txt" || fi.suffix() == "csv")
     {
-      doc->setPlainText(toCsv());
-      writer.setFormat("plaintext");
+      // write big lists in the background, formatted as the document would be
+      fetchAllPages();
+      XTreeWidgetExportThread *thread =
+        new XTreeWidgetExportThread(exportHeader(),
+                                    fi.suffix() == "csv" ? XTreeWidgetExporter::Csv
+                                                         : XTreeWidgetExporter::Txt,
+                                    fi.filePath(),
+                                    XTreeWidgetExporter::PlainTextDocument);
+      connect(thread, SIGNAL(rowsWanted()), this,   SLOT(sExportRowsWanted()));
+      connect(thread, SIGNAL(finished()),   this,   SLOT(sExportFinished()));
+      connect(thread, SIGNAL(finished()),   thread, SLOT(deleteLater()));
+      connect(this,   SIGNAL(destroyed()),  thread, SLOT(cancel()));
+
+      XTreeWidgetRows rows;
+      QModelIndex     last = exportRows(topLevelItem(0) ? indexFromItem(topLevelItem(0))
+                                                        : QModelIndex(),
+                                        EXPORTROWS, rows);
+      if (rows.size() == EXPORTROWS)
+        _exports.insert(thread, last);
+      thread->appendRows(rows, rows.size() < EXPORTROWS);
+      thread->start();
+      delete doc;
+      return;
     }
     else if (fi.suffix() == "vcf")
     {
@@ -1612,6 +2697,43 @@ void XTreeWidget::sExport()
   }
 }
 
+void XTreeWidget::sExportFinished()
+{
+  XTreeWidgetExportThread *thread = qobject_cast<XTreeWidgetExportThread *>(sender());
+  _exports.remove(thread);
+  if (thread && ! thread->errorString().isEmpty())
+    QMessageBox::critical(this, tr("Export Failed"),
+                          tr("Could not export to %1:\n%2")
+                            .arg(thread->fileName(), thread->errorString()));
+}
+
+/* give an export thread the rows after the last ones it was given. the
+   list may change in between, but if that row was deleted there's no
+   telling where to go on from, so the export stops with an error.
+ */
+void XTreeWidget::sExportRowsWanted()
+{
+  XTreeWidgetExportThread *thread = qobject_cast<XTreeWidgetExportThread *>(sender());
+  if (! thread || ! _exports.contains(thread))
+    return;
+
+  QPersistentModelIndex last = _exports.value(thread);
+  if (! last.isValid())
+  {
+    _exports.remove(thread);
+    thread->cancel(tr("The list changed before the export finished."));
+    return;
+  }
+
+  XTreeWidgetRows rows;
+  QModelIndex     next = exportRows(indexBelow(last), EXPORTROWS, rows);
+  if (rows.size() == EXPORTROWS)
+    _exports.insert(thread, next);
+  else
+    _exports.remove(thread);
+  thread->appendRows(rows, rows.size() < EXPORTROWS);
+}
+
 void XTreeWidget::mousePressEvent(QMouseEvent *event)
 {
   if (event->button() == Qt::LeftButton)
@@ -1657,9 +2779,20 @@ void XTreeWidget::sHeaderClicked(int column)
   // Qt::SortOrder sortOrder = Qt::DescendingOrder;
   if (!header()->isSortIndicatorShown())
     header()->setSortIndicatorShown(true);
+  if (_pager && _pager->sort(column, header()->sortIndicatorOrder()))
+    return;
   sortItems(column, header()->sortIndicatorOrder());
 }
 
+/* bring in the rows a pager hasn't fetched yet, before copying or
+   exporting what is supposed to be the whole list
+ */
+void XTreeWidget::fetchAllPages() const
+{
+  if (_pager)
+    _pager->fetchAll();
+}
+
 void XTreeWidget::sColumnSizeChanged(int logicalIndex, int /*oldSize*/, int /*newSize*/)
 {
   if (_resizingInProcess || _stretch.count() < 1)
@@ -1803,23 +2936,10 @@ void XTreeWidget::setColumnLocked(int pColumn, bool pLocked)
 
 XTreeWidgetItem *XTreeWidget::findXTreeWidgetItemWithId(const XTreeWidget *ptree, const int pid)
 {
-  if (pid < 0)
+  if (pid < 0 || ! ptree)
     return 0;
 
-  for (int i = 0; i < ptree->topLevelItemCount(); i++)
-  {
-    XTreeWidgetItem *item = ptree->topLevelItem(i);
-    if (item->id() == pid)
-      return item;
-    else
-    {
-      item = findXTreeWidgetItemWithId(item, pid);
-      if (item)
-        return item;
-    }
-  }
-
-  return 0;
+  return ptree->itemWithId(pid);
 }
 
 XTreeWidgetItem *XTreeWidget::findXTreeWidgetItemWithId(const XTreeWidgetItem *ptreeitem, const int pid)
@@ -1895,6 +3015,10 @@ void XTreeWidgetItem::constructor(int pId, int pAltId, QVariant v0,QVariant v1,
 {
   _id    = pId;
   _altId = pAltId;
+  _resultRow = -1;
+  _runningRow = -1;
+  _sortKeyColumn = -1;
+  _compact = false;
 
   if (!v0.isNull())
     setText(0,  v0);
@@ -1937,6 +3061,94 @@ void XTreeWidgetItem::constructor(int pId, int pAltId, QVariant v0,QVariant v1,
   }
 }
 
+/* Values set explicitly on the item win. Otherwise items populated with
+   populateLazy ask the result set, which formats the cell on demand.
+ */
+QVariant XTreeWidgetItem::data(int colidx, int role) const
+{
+  if (role == Qt::DisplayRole)
+  {
+    XTreeWidget *tree = qobject_cast<XTreeWidget *>(treeWidget());
+    if (tree && ! tree->_running.isEmpty())
+    {
+      QVariant running = tree->runningTotal(this, colidx);
+      if (running.isValid())
+        return running;
+    }
+  }
+
+  QVariant value = QTreeWidgetItem::data(colidx, role);
+  if (value.isValid())
+    return value;
+  else if (_resultSet)
+    return _resultSet->data(_resultRow, colidx, role);
+  else if (_compact)
+    return columnDefault(colidx, role);
+
+  return value;
+}
+
+/* populate() leaves out cell data the column already knows:
+   display text that is just the raw value, the alignment from
+   addColumn(), and the scale of columns with a fixed scale.
+ */
+QVariant XTreeWidgetItem::columnDefault(int column, int role) const
+{
+  switch (role)
+  {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+      return QTreeWidgetItem::data(column, Xt::RawRole);
+
+    case Qt::TextAlignmentRole:
+    case Xt::ScaleRole:
+      if (treeWidget())
+        return treeWidget()->headerItem()->data(column, role);
+      break;
+
+    default:
+      break;
+  }
+
+  return QVariant();
+}
+
+void XTreeWidgetItem::setData(int column, int role, const QVariant &value)
+{
+  QTreeWidgetItem::setData(column, role, value);
+
+  if (role == Xt::RawRole && column == _sortKeyColumn)
+    _sortKey.clear();
+
+  // keep a running column current without rebuilding it
+  if (role == Xt::RawRole && _runningRow >= 0 && ! QTreeWidgetItem::parent())
+  {
+    XTreeWidget *tree = qobject_cast<XTreeWidget *>(treeWidget());
+    // rows past a pending change are appended again with their new values
+    QMap<int, XTreeWidgetRunningTotal>::iterator it;
+    if (tree && (it = tree->_running.find(column)) != tree->_running.end() &&
+        _runningRow < it.value().rowCount())
+    {
+      it.value().setRawValue(_runningRow, value.toDouble());
+      tree->viewport()->update();
+    }
+  }
+}
+
+void XTreeWidgetItem::setId(int pId)
+{
+  _id = pId;
+  if (XTreeWidget *tree = dynamic_cast<XTreeWidget *>(treeWidget()))
+    tree->sInvalidateIdIndex();
+}
+
+void XTreeWidgetItem::setAltId(int pId)
+{
+  _altId = pId;
+  if (XTreeWidget *tree = dynamic_cast<XTreeWidget *>(treeWidget()))
+    tree->sInvalidateIdIndex();
+}
+
 int XTreeWidgetItem::id(const QString p)
 {
   int id = data(((XTreeWidget *)treeWidget())->column(p), Xt::IdRole).toInt();
@@ -2316,6 +3528,7 @@ void XTreeWidget::sCopyColumnToClipboard()
   QMimeData       *mime      = new QMimeData();
   QClipboard      *clipboard = QApplication::clipboard();
   QString opText = "";
+  fetchAllPages();
   XTreeWidgetItem *item = topLevelItem(0);
   if (item)
   {
@@ -2335,107 +3548,161 @@ void XTreeWidget::sCopyColumnToClipboard()
 void XTreeWidget::sSearch(const QString &pTarget)
 {
   clearSelection();
-  int i;
-  for (i = 0; i < topLevelItemCount(); i++)
+
+  // without search columns this only looks at the first column
+  QList<int> columns = _searchColumns;
+  if (columns.isEmpty())
+    columns.append(0);
+
+  int found = -1;
+  for (int i = 0; i < columns.size(); i++)
   {
-    // Currently this only looks at the first column
-    if (topLevelItem(i)->text(0).contains(pTarget, Qt::CaseInsensitive))
-      break;
+    int row = findFirstRow(pTarget, Qt::MatchContains, columns.at(i));
+    if (row >= 0 && (found < 0 || row < found))
+      found = row;
   }
 
-  if (i < topLevelItemCount())
+  if (found >= 0)
   {
-    setCurrentItem(topLevelItem(i));
-    scrollToItem(topLevelItem(i));
+    setCurrentItem(topLevelItem(found));
+    scrollToItem(topLevelItem(found));
   }
 }
 
-QString XTreeWidget::toTxt() const
+QStringList XTreeWidget::exportHeader() const
 {
-  QString line;
-  QString opText;
-  int     counter;
-
+  QStringList result;
   QTreeWidgetItem *header = headerItem();
-  for (counter = 0; counter < header->columnCount(); counter++)
+  for (int counter = 0; counter < header->columnCount(); counter++)
   {
     if (!QTreeWidget::isColumnHidden(counter))
-      line = line + header->text(counter).replace("\r\n"," ") + "\t";
+      result.append(header->text(counter));
   }
-  opText = line + "\r\n";
+  return result;
+}
 
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
+/* read up to count visible rows, starting with first and going down as
+   the view does, into rows. returns the last row read.
+ */
+QModelIndex XTreeWidget::exportRows(const QModelIndex &first, int count, XTreeWidgetRows &rows) const
+{
+  rows.clear();
+  rows.reserve(count);
+
+  QModelIndex last;
+  for (QModelIndex idx = first; idx.isValid() && rows.size() < count; idx = indexBelow(idx))
   {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid(); idx = indexBelow(idx))
+    last = idx;
+    XTreeWidgetItem *item = (XTreeWidgetItem *)itemFromIndex(idx);
+    if (item)
     {
-      item = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
+      QVector<QVariant> row;
+      row.reserve(item->columnCount());
+      for (int counter = 0; counter < item->columnCount(); counter++)
       {
-        line = "";
-        for (counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-            line = line + item->text(counter) + "\t";
-        }
+        if (!QTreeWidget::isColumnHidden(counter))
+          row.append(item->data(counter, Qt::DisplayRole));
       }
-      opText = opText + line + "\r\n";
+      rows.append(row);
     }
   }
-  return opText;
+  return last;
 }
 
-QString XTreeWidget::toCsv() const
+/* write the whole list through writer, EXPORTROWS rows at a time */
+void XTreeWidget::exportAll(XTreeWidgetExporter &writer) const
 {
-  QString line;
-  QString opText;
-  int     counter;
-  int     colcount         = 0;
+  fetchAllPages();
+  writer.writeHeader(exportHeader());
 
-  QTreeWidgetItem *header  = headerItem();
-  for (counter = 0; counter < header->columnCount(); counter++)
+  XTreeWidgetRows rows;
+  QModelIndex     last;
+  QModelIndex     next = topLevelItem(0) ? indexFromItem(topLevelItem(0)) : QModelIndex();
+  while (next.isValid())
   {
-    if (!QTreeWidget::isColumnHidden(counter))
-    {
-      if (colcount)
-        line = line + ",";
-      line = line + header->text(counter).replace("\"","\"\"").replace("\r\n"," ").replace("\n"," ");
-      colcount++;
-    }
+    last = exportRows(next, EXPORTROWS, rows);
+    writer.writeRows(rows);
+    next = indexBelow(last);
   }
-  opText = line + "\r\n";
+}
 
-  XTreeWidgetItem *item = topLevelItem(0);
-  if (item)
-  {
-    for (QModelIndex idx = indexFromItem(item); idx.isValid(); idx = indexBelow(idx))
-    {
-      colcount = 0;
-      item     = (XTreeWidgetItem *)itemFromIndex(idx);
-      if (item)
-      {
-        line = "";
-        for (counter = 0; counter < item->columnCount(); counter++)
-        {
-          if (!QTreeWidget::isColumnHidden(counter))
-          {
-            if (colcount)
-              line = line + ",";
-            if (item->data(counter,Qt::DisplayRole).type() == QVariant::String)
-              line = line + "\"";
-            line = line + item->text(counter).replace("\"","\"\"");
-            if (item->data(counter,Qt::DisplayRole).type() == QVariant::String)
-              line = line + "\"";
-            colcount++;
-          }
-        }
-      }
-      opText = opText + line + "\r\n";
-    }
-  }
+QString XTreeWidget::toTxt() const
+{
+  QString     opText;
+  QTextStream stream(&opText);
+  XTreeWidgetExporter writer(XTreeWidgetExporter::Txt, stream);
+  exportAll(writer);
+  stream.flush();
   return opText;
 }
 
+QString XTreeWidget::toCsv() const
+{
+  QString     opText;
+  QTextStream stream(&opText);
+  XTreeWidgetExporter writer(XTreeWidgetExporter::Csv, stream);
+  exportAll(writer);
+  stream.flush();
+  return opText;
+}
+
+/*!
+  Writes the same text as toTxt() to \a device, encoded as UTF-8,
+  a few hundred rows at a time instead of building it in memory first.
+*/
+bool XTreeWidget::writeTxt(QIODevice *device) const
+{
+  if (! device || ! device->isWritable())
+    return false;
+
+  QTextStream stream(device);
+  stream.setCodec("UTF-8");
+  XTreeWidgetExporter writer(XTreeWidgetExporter::Txt, stream);
+  exportAll(writer);
+  stream.flush();
+  return stream.status() == QTextStream::Ok;
+}
+
+/*!
+  Writes the same text as toCsv() to \a device, encoded as UTF-8,
+  a few hundred rows at a time instead of building it in memory first.
+*/
+bool XTreeWidget::writeCsv(QIODevice *device) const
+{
+  if (! device || ! device->isWritable())
+    return false;
+
+  QTextStream stream(device);
+  stream.setCodec("UTF-8");
+  XTreeWidgetExporter writer(XTreeWidgetExporter::Csv, stream);
+  exportAll(writer);
+  stream.flush();
+  return stream.status() == QTextStream::Ok;
+}
+
+/*!
+  Writes toVcf() to \a device as UTF-8. A vCard only holds the selected
+  contact so there's nothing to gain from streaming it.
+*/
+bool XTreeWidget::writeVcf(QIODevice *device) const
+{
+  if (! device || ! device->isWritable())
+    return false;
+  return device->write(toVcf().toUtf8()) >= 0;
+}
+
+/*!
+  Writes toHtml() to \a device as UTF-8. The HTML comes from a
+  QTextDocument so, unlike writeTxt() and writeCsv(), this still builds
+  the whole table in memory.
+*/
+bool XTreeWidget::writeHtml(QIODevice *device) const
+{
+  if (! device || ! device->isWritable())
+    return false;
+  return device->write(toHtml().toUtf8()) >= 0;
+}
+
 QString XTreeWidget::toVcf() const
 {
   XSqlQuery qry;
@@ -2539,6 +3806,7 @@ QString XTreeWidget::toVcf() const
 
 QString XTreeWidget::toHtml() const
 {
+  fetchAllPages();
   QTextDocument     *doc     = new QTextDocument();
   QTextCursor       *cursor  = new QTextCursor(doc);
   QTextTableFormat  tableFormat;
@@ -2680,6 +3948,23 @@ QList<XTreeWidgetItem *> XTreeWidget::findItems(const QString &text, Qt::MatchFl
   return *xlist;
 }
 
+/*! Returns the first item matching \a text in \a column, or 0.
+    Case-insensitive Qt::MatchStartsWith and Qt::MatchContains searches of
+    top-level items stop at the first match and use the search index if
+    \a column is one of the searchColumns(). Other \a flags behave as
+    they do for findItems().
+ */
+XTreeWidgetItem *XTreeWidget::findFirstItem(const QString &text, Qt::MatchFlags flags, int column) const
+{
+  int matchType = flags & 0x0F;
+  if ((matchType != Qt::MatchStartsWith && matchType != Qt::MatchContains) ||
+      (flags & (Qt::MatchCaseSensitive | Qt::MatchRecursive)))
+    return findItems(text, flags, column).value(0);
+
+  int row = findFirstRow(text, matchType, column);
+  return row < 0 ? 0 : topLevelItem(row);
+}
+
 void XTreeWidget::insertTopLevelItems(int index, const QList<XTreeWidgetItem *> &items)
 {
   QList<QTreeWidgetItem *> qlist = QTreeWidget::selectedItems();
@@ -13,14 +13,22 @@
 
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
+#include <QSharedPointer>
 #include <QVariant>
 #include <QVector>
 #include <QTimer>
+#include <QHash>
+#include <QSet>
 #include <QHeaderView> //#13251
+#include <QLocale>
+#include <QPointer>
 
+#include "dbconnection.h"
 #include "widgets.h"
 #include "guiclientinterface.h"
 #include "xt.h"
+#include "xtreewidgetexporter.h"
+#include "xtreewidgetrunningtotal.h"
 
 //  Table Column Widths
 #define _itemColumn     100
@@ -51,13 +59,46 @@
 // make sure ROWROLE_COUNT = last ROWROLE + 1
 #define ROWROLE_COUNT         3
 
+/* make sure the colroles are kept in sync with
+   QStringList knownroles in XTreeWidget::populateWorker(),
+   both in count and order
+   */
+#define COLROLE_DISPLAY       0
+#define COLROLE_TEXTALIGNMENT 1
+#define COLROLE_BACKGROUND    2
+#define COLROLE_FOREGROUND    3
+#define COLROLE_TOOLTIP       4
+#define COLROLE_STATUSTIP     5
+#define COLROLE_FONT          6
+#define COLROLE_KEY           7
+#define COLROLE_RUNNING       8
+#define COLROLE_RUNNINGINIT   9
+#define COLROLE_GROUPRUNNING  10
+#define COLROLE_TOTAL         11
+#define COLROLE_NUMERIC       12
+#define COLROLE_NULL          13
+#define COLROLE_ID            14
+// make sure COLROLE_COUNT = last COLROLE + 1
+#define COLROLE_COUNT         15
+
 #include "xsqlquery.h"
 
+class ParameterList;
 class QAction;
+class QIODevice;
 class QMenu;
 class QScriptEngine;
+class QSqlRecord;
 class XTreeWidget;
+class XTreeWidgetFetchThread;
+class XTreeWidgetPager;
 class XTreeWidgetProgress;
+class XTreeWidgetResultSet;
+class XTreeWidgetRow;
+class XTreeWidgetRowBatch;
+class XTreeWidgetSearchIndex;
+class XTreeWidgetSearchIndexThread;
+struct XTreeWidgetSortKey;
 
 class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetItem
 {
@@ -123,11 +164,11 @@ class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetI
 
     Q_INVOKABLE inline int              id() const        { return _id;    }
     Q_INVOKABLE inline int              altId() const     { return _altId; }
-    Q_INVOKABLE inline void             setId(int pId)    { _id = pId;     }
-    Q_INVOKABLE inline void             setAltId(int pId) { _altId = pId;  }
+    Q_INVOKABLE void                    setId(int pId);
+    Q_INVOKABLE void                    setAltId(int pId);
 
-    Q_INVOKABLE inline QVariant         data(int colidx,    int role) const { return QTreeWidgetItem::data(colidx, role); }
-    Q_INVOKABLE inline void             setData(int colidx, int role, const QVariant &val) { QTreeWidgetItem::setData(colidx, role, val); }
+    Q_INVOKABLE virtual QVariant        data(int colidx,    int role) const;
+    Q_INVOKABLE virtual void            setData(int colidx, int role, const QVariant &val);
     Q_INVOKABLE virtual QVariant        rawValue(const QString colname);
     Q_INVOKABLE virtual int             id(const QString);
 
@@ -153,18 +194,57 @@ class XTUPLEWIDGETS_EXPORT XTreeWidgetItem : public QObject, public QTreeWidgetI
     void constructor( int, int, QVariant, QVariant, QVariant,
                       QVariant, QVariant, QVariant, QVariant,
                       QVariant, QVariant, QVariant, QVariant );
+    QVariant columnDefault(int column, int role) const;
+    const XTreeWidgetSortKey &sortKey(int column) const;
 
     int _id;
     int _altId;
+    QSharedPointer<XTreeWidgetResultSet> _resultSet;
+    int _resultRow;
+    int _runningRow;
+    bool _compact;    // cells left out by XTreeWidget::fillRowItem()
+    mutable QSharedPointer<XTreeWidgetSortKey> _sortKey;  // cached by operator<
+    mutable int _sortKeyColumn;
 };
 
 class XTreeWidgetPopulateParams;
 
+/* Formatting state resolved once per populate() instead of once per cell:
+   the locale, the default and per-xtnumericrole scales, named colors,
+   and each column's default alignment. It also interns the text of
+   low-cardinality columns so equal cells share one string.
+ */
+class XTreeWidgetColumnPlan
+{
+  public:
+    XTreeWidgetColumnPlan(const QVector<QVariant> &alignment = QVector<QVariant>());
+
+    inline const QLocale &locale()       const { return _locale;       }
+    inline int            defaultScale() const { return _defaultScale; }
+    inline QVariant       alignment(int col) const { return _alignment.value(col); }
+    int                   scale(const QString &numericrole);
+    QVariant              color(const QString &name);
+    QString               intern(int col, const QString &text);
+
+  private:
+    QLocale                 _locale;
+    int                     _defaultScale;
+    QVector<QVariant>       _alignment;
+    QHash<QString, int>     _scales;
+    QHash<QString, QVariant> _colors;
+    QVector<QSet<QString> > _strings;    // interned text by column
+    QVector<bool>           _interning;  // false once a column has too many values
+};
+
 class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
 {
+  friend class XTreeWidgetItem;
+  friend class XTreeWidgetPager;
+
   Q_OBJECT Q_PROPERTY(QString dragString READ dragString WRITE setDragString)
   Q_PROPERTY( QString altDragString READ altDragString WRITE setAltDragString)
   Q_PROPERTY( bool populateLinear READ populateLinear WRITE setPopulateLinear)
+  Q_PROPERTY( bool populateLazy   READ populateLazy   WRITE setPopulateLazy)
 
   public :
     enum PopulateStyle { Replace, Append };
@@ -177,6 +257,19 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     Q_INVOKABLE void  populate(XSqlQuery, int, bool = false, PopulateStyle = Replace);
     void    populate(const QString&, bool = false);
     void    populate(const QString&, int, bool = false);
+    void    populateAsync(const QString &metasql, const ParameterList &params,
+                          const QMap<QString, QVariant> &bindings = QMap<QString, QVariant>(),
+                          int pIndex = -1, bool pUseAltId = false,
+                          const DbConnection &connection = DbConnection());
+    bool    isFetching() const;
+    void    populateRows(const QSqlRecord &record, const XTreeWidgetRowBatch &rows,
+                         int pIndex = -1, bool pUseAltId = false);
+    Q_INVOKABLE bool applyChanges(XSqlQuery pUpserts, const QList<int> &pRemoved, bool pUseAltId = false);
+    Q_INVOKABLE bool upsertRows(XSqlQuery pQuery, bool pUseAltId = false);
+    Q_INVOKABLE bool removeRows(const QList<int> &pIds);
+
+    Q_INVOKABLE void       setSearchColumns(const QList<int> &pColumns, Qt::MatchFlags pMatch = Qt::MatchContains);
+    Q_INVOKABLE QList<int> searchColumns() const { return _searchColumns; }
 
     QString dragString() const;
     void    setDragString(QString);
@@ -184,6 +277,8 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void    setAltDragString(QString);
     bool    populateLinear();
     void    setPopulateLinear(bool alwaysLinear = true);
+    bool    populateLazy() const;
+    void    setPopulateLazy(bool lazy = true);
 
     Q_INVOKABLE int   altId() const;
     Q_INVOKABLE int   id()    const;
@@ -198,16 +293,24 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     Q_INVOKABLE virtual void            setColumnLocked(int, bool);
     Q_INVOKABLE virtual void            setColumnVisible(int, bool);
     Q_INVOKABLE virtual void            sortItems(int column, Qt::SortOrder order);
+    virtual void                        sortItems(const QList<int> &columns, const QList<Qt::SortOrder> &orders);
     Q_INVOKABLE virtual XTreeWidgetItem *topLevelItem(int idx) const;
 
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidget *ptree, const int pid);
     Q_INVOKABLE XTreeWidgetItem         *findXTreeWidgetItemWithId(const XTreeWidgetItem *ptreeitem, const int pid);
+    Q_INVOKABLE XTreeWidgetItem         *itemWithId(int pId) const;
+    Q_INVOKABLE XTreeWidgetItem         *itemWithId(int pId, int pAltId) const;
 
     Q_INVOKABLE QString toTxt() const;
     Q_INVOKABLE QString toCsv() const;
     Q_INVOKABLE QString toVcf() const;
     Q_INVOKABLE QString toHtml() const;
 
+    bool    writeTxt(QIODevice *device) const;
+    bool    writeCsv(QIODevice *device) const;
+    bool    writeVcf(QIODevice *device) const;
+    bool    writeHtml(QIODevice *device) const;
+
     // just for scripting exposure:
     Q_INVOKABLE inline void addTopLevelItem(XTreeWidgetItem *item) {        QTreeWidget::addTopLevelItem(item); }
     Q_INVOKABLE void        addTopLevelItems(const QList<XTreeWidgetItem *> &items);
@@ -216,6 +319,7 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     Q_INVOKABLE inline int  currentColumn() const { return QTreeWidget::currentColumn(); }
     Q_INVOKABLE inline void editItem(XTreeWidgetItem *item, int column = 0) {        QTreeWidget::editItem(item, column); }
     Q_INVOKABLE QList<XTreeWidgetItem *>  findItems(const QString &text, Qt::MatchFlags flags, int column = 0, int role = 0) const;
+    Q_INVOKABLE XTreeWidgetItem           *findFirstItem(const QString &text, Qt::MatchFlags flags, int column = 0) const;
     Q_INVOKABLE inline QTreeWidgetItem    *headerItem() const { return QTreeWidget::headerItem(); }
     Q_INVOKABLE inline int                indexOfTopLevelItem(XTreeWidgetItem *item) const { return QTreeWidget::indexOfTopLevelItem(item); }
     Q_INVOKABLE inline void               insertTopLevelItem(int index, XTreeWidgetItem *item) {        QTreeWidget::insertTopLevelItem(index, item); }
@@ -262,6 +366,7 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  sCopyCellToClipboard();
     void  sCopyColumnToClipboard();
     void  sSearch(const QString&);
+    void  sCancelFetch();
 
   signals:
     void  valid(bool);
@@ -282,6 +387,7 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  populateMenu(QMenu *, XTreeWidgetItem *, int);
     void  resorted();
     void  populated();
+    void  populateFailed(const QString &message);
 
   protected slots:
     void  sHeaderClicked(int);
@@ -328,15 +434,61 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     QTimer        _workingTimer;
     bool          _alwaysLinear;
     bool          _linear;
+    bool          _lazy;
+    QSharedPointer<XTreeWidgetResultSet> _resultSet;
 
     QVector<int>    *_colIdx;
     QVector<int *>  *_colRole;
+    XTreeWidgetColumnPlan *_plan;
     int              _fieldCount;
     XTreeWidgetItem *_last;
     int              _rowRole[ROWROLE_COUNT];
     void             cleanupAfterPopulate();
+    void             preparePopulate(const QSqlRecord &record, int size);
+    void             showProgress(int maximum);
+    void             populateRow(const XTreeWidgetRow &row, bool pUseAltId,
+                                 QList<XTreeWidgetItem *> &topLevelItems);
+    void             populateOldStyleRow(const XTreeWidgetRow &row, bool pUseAltId);
+    bool             fillRowItem(XTreeWidgetItem *item, const XTreeWidgetRow &row,
+                                 int indent, bool child = false);
+    void             finishPopulate();
+
+    XTreeWidgetFetchThread *_fetch;
+    int              _fetchIndex;
+    bool             _fetchUseAltId;
+    int              _fetchCount;
+
+    mutable QHash<int, XTreeWidgetItem *>              _idIndex;
+    mutable QHash<QPair<int, int>, XTreeWidgetItem *>  _idAltIndex;
+    mutable bool     _idIndexDirty;
+    void             buildIdIndex() const;
+    bool             indexItem(XTreeWidgetItem *item) const;
+    XTreeWidgetItem *shownItemWithId(int pId, int pAltId, bool pUseAltId) const;
     XTreeWidgetProgress *_progress;
-    QList<QMap<int, double> *> *_subtotals;
+    mutable QMap<int, XTreeWidgetRunningTotal> _running;  // by xtrunningrole column
+    mutable int      _runningRows;  // top-level rows already in _running
+    void             buildRunningTotals() const;
+    void             appendRunningTotals() const;
+    void             truncateRunningTotals(int row);
+    QMap<int, QMap<int, double> > _childSubtotals;  // by xtrunningrole column and set, over populated rows
+    bool             _runningChildren;  // a child row shows a subtotal from _childSubtotals
+    QMap<int, QMap<int, double> > _totals;  // by xttotalrole column and total set
+    QMap<int, int>   _totalScales;
+    int              _appendedFrom; // first row of rows appended in order, or -1
+    void             populateCalculatedColumns(int from);
+    QVariant         runningTotal(const XTreeWidgetItem *item, int column) const;
+    QList<int>       _searchColumns;
+    int              _searchMode;
+    XTreeWidgetSearchIndex       *_searchIndex;
+    XTreeWidgetSearchIndexThread *_searchIndexBuild;
+    QTimer           _searchIndexTimer;
+    int              findFirstRow(const QString &text, int matchType, int column) const;
+    QPointer<XTreeWidgetPager> _pager;
+    void             fetchAllPages() const;
+    QStringList      exportHeader() const;
+    QModelIndex      exportRows(const QModelIndex &first, int count, XTreeWidgetRows &rows) const;
+    void             exportAll(XTreeWidgetExporter &writer) const;
+    QHash<QObject *, QPersistentModelIndex> _exports;  // export thread -> last row given to it
 
   private slots:
     void  sSelectionChanged();
@@ -352,6 +504,19 @@ class XTUPLEWIDGETS_EXPORT XTreeWidget : public QTreeWidget
     void  sToggleForgetfulness();
     void  sToggleForgetfulnessOrder();
     void  popupMenuActionTriggered(QAction *);
+    void  sExportFinished();
+    void  sExportRowsWanted();
+    void  sInvalidateIdIndex();
+    void  sRowsInserted(const QModelIndex &parent, int first, int last);
+    void  sInvalidateRunningTotals();
+    void  sRunningRowsChanged(const QModelIndex &parent, int first, int last);
+    void  sInvalidateSearchIndex();
+    void  sBuildSearchIndex();
+    void  sSearchDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void  sSearchIndexBuilt();
+    void  sFetchRecordReady(const QSqlRecord &record, int size);
+    void  sFetchRowsReady(const XTreeWidgetRowBatch &batch);
+    void  sFetchFinished();
 };
 
 class XTreeWidgetPopulateParams
@@ -0,0 +1,212 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetexporter.h"
+
+#include <QFile>
+#include <QIODevice>
+#include <QTextStream>
+
+#define DEBUG false
+
+/* XTreeWidget::sExport() used to pass the text through a QTextDocument.
+   Reproduce what setPlainText() followed by toPlainText() did to it:
+   \r\n and the other paragraph breaks become \n and non-breaking spaces
+   become plain spaces.
+ */
+static QString asPlainTextDocument(const QString &text)
+{
+  QString result;
+  result.reserve(text.size());
+  for (int i = 0; i < text.size(); i++)
+  {
+    QChar c = text.at(i);
+    if (c == QLatin1Char('\r'))
+    {
+      if (i + 1 < text.size() && text.at(i + 1) == QLatin1Char('\n'))
+        i++;
+      result.append(QLatin1Char('\n'));
+    }
+    else if (c == QChar::ParagraphSeparator || c == QChar::LineSeparator ||
+             c.unicode() == 0xfdd0 || c.unicode() == 0xfdd1)
+      result.append(QLatin1Char('\n'));
+    else if (c == QChar::Nbsp)
+      result.append(QLatin1Char(' '));
+    else
+      result.append(c);
+  }
+  return result;
+}
+
+static QString txtHeader(const QStringList &header)
+{
+  QString line;
+  for (int i = 0; i < header.size(); i++)
+    line = line + QString(header.at(i)).replace("\r\n"," ") + "\t";
+  return line;
+}
+
+static QString txtRow(const QVector<QVariant> &row)
+{
+  QString line;
+  for (int i = 0; i < row.size(); i++)
+    line = line + row.at(i).toString() + "\t";
+  return line;
+}
+
+static QString csvHeader(const QStringList &header)
+{
+  QString line;
+  for (int i = 0; i < header.size(); i++)
+  {
+    if (i)
+      line = line + ",";
+    line = line + QString(header.at(i)).replace("\"","\"\"").replace("\r\n"," ").replace("\n"," ");
+  }
+  return line;
+}
+
+static QString csvRow(const QVector<QVariant> &row)
+{
+  QString line;
+  for (int i = 0; i < row.size(); i++)
+  {
+    bool quote = (row.at(i).type() == QVariant::String);
+    if (i)
+      line = line + ",";
+    if (quote)
+      line = line + "\"";
+    line = line + row.at(i).toString().replace("\"","\"\"");
+    if (quote)
+      line = line + "\"";
+  }
+  return line;
+}
+
+XTreeWidgetExporter::XTreeWidgetExporter(Format format, QTextStream &stream, Options options)
+  : _format(format),
+    _stream(stream),
+    _options(options)
+{
+}
+
+void XTreeWidgetExporter::writeHeader(const QStringList &header)
+{
+  writeLine((_format == Csv) ? csvHeader(header) : txtHeader(header));
+}
+
+void XTreeWidgetExporter::writeRows(const XTreeWidgetRows &rows)
+{
+  for (int i = 0; i < rows.size(); i++)
+    writeLine((_format == Csv) ? csvRow(rows.at(i)) : txtRow(rows.at(i)));
+}
+
+void XTreeWidgetExporter::writeLine(QString line)
+{
+  line += "\r\n";
+  if (_options & PlainTextDocument)
+    _stream << asPlainTextDocument(line);
+  else
+    _stream << line;
+}
+
+XTreeWidgetExportThread::XTreeWidgetExportThread(const QStringList &header,
+                                                 XTreeWidgetExporter::Format format,
+                                                 const QString &filename,
+                                                 XTreeWidgetExporter::Options options,
+                                                 QObject *parent)
+  : QThread(parent),
+    _header(header),
+    _format(format),
+    _filename(filename),
+    _options(options),
+    _last(false),
+    _cancelled(false)
+{
+}
+
+/* queue the next batch; last says no more will follow */
+void XTreeWidgetExportThread::appendRows(const XTreeWidgetRows &rows, bool last)
+{
+  QMutexLocker locker(&_mutex);
+  if (_last || _cancelled)
+    return;
+  _queue.enqueue(rows);
+  _last = last;
+  _wake.wakeOne();
+}
+
+QString XTreeWidgetExportThread::errorString() const
+{
+  QMutexLocker locker(&_mutex);
+  return _errorString;
+}
+
+/* stop writing, leaving what was written so far. errorString explains
+   why, if the export can't be finished.
+ */
+void XTreeWidgetExportThread::cancel(const QString &errorString)
+{
+  QMutexLocker locker(&_mutex);
+  _cancelled = true;
+  if (_errorString.isEmpty())
+    _errorString = errorString;
+  _wake.wakeOne();
+}
+
+void XTreeWidgetExportThread::run()
+{
+  QFile file(_filename);
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+  {
+    QMutexLocker locker(&_mutex);
+    _errorString = file.errorString();
+    return;
+  }
+
+  QTextStream stream(&file);
+  stream.setCodec("UTF-8");
+  XTreeWidgetExporter writer(_format, stream, _options);
+  writer.writeHeader(_header);
+
+  int  rowcount = 0;
+  bool last     = false;
+  while (! last && stream.status() == QTextStream::Ok)
+  {
+    XTreeWidgetRows rows;
+    {
+      QMutexLocker locker(&_mutex);
+      while (_queue.isEmpty() && ! _cancelled)
+        _wake.wait(&_mutex);
+      if (_cancelled)
+        break;
+      rows = _queue.dequeue();
+      last = _last && _queue.isEmpty();
+    }
+
+    // let the GUI thread read the next batch while this one is written
+    if (! last)
+      emit rowsWanted();
+    writer.writeRows(rows);
+    rowcount += rows.size();
+  }
+  stream.flush();
+
+  if (stream.status() != QTextStream::Ok)
+  {
+    QMutexLocker locker(&_mutex);
+    _errorString = file.errorString();
+  }
+  file.close();
+
+  if (DEBUG)
+    qDebug("XTreeWidgetExportThread::run() wrote %d rows to %s: %s",
+           rowcount, qPrintable(_filename), qPrintable(errorString()));
+}
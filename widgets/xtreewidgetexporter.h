@@ -0,0 +1,106 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETEXPORTER_H
+#define XTREEWIDGETEXPORTER_H
+
+#include <QMutex>
+#include <QQueue>
+#include <QStringList>
+#include <QThread>
+#include <QVariant>
+#include <QVector>
+#include <QWaitCondition>
+
+class QIODevice;
+class QTextStream;
+
+/* A batch of visible rows of an XTreeWidget, in display order, holding
+   the Qt::DisplayRole of each visible cell. XTreeWidget reads them a
+   batch at a time on the GUI thread so an export never holds the whole
+   list in memory.
+ */
+typedef QVector<QVector<QVariant> > XTreeWidgetRows;
+
+/* Writes the header and batches of rows of an XTreeWidget to a stream
+   as tab- or comma-separated text, a line at a time.
+ */
+class XTreeWidgetExporter
+{
+  public:
+    enum Format { Txt, Csv };
+
+    enum Option
+    {
+      NoOptions         = 0x0,
+      PlainTextDocument = 0x1   // match QTextDocument::toPlainText() output
+    };
+    Q_DECLARE_FLAGS(Options, Option)
+
+    XTreeWidgetExporter(Format format, QTextStream &stream, Options options = NoOptions);
+
+    void writeHeader(const QStringList &header);
+    void writeRows(const XTreeWidgetRows &rows);
+
+  private:
+    void writeLine(QString line);
+
+    Format       _format;
+    QTextStream &_stream;
+    Options      _options;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(XTreeWidgetExporter::Options)
+
+/* Writes rows to a file without blocking the GUI thread. It asks for
+   each batch with rowsWanted() as it starts writing the one before, so
+   at most two batches are in memory. Call appendRows() on the GUI thread
+   with the first batch before start() and then once per rowsWanted().
+   Delete it after finished() is emitted.
+ */
+class XTreeWidgetExportThread : public QThread
+{
+  Q_OBJECT
+
+  public:
+    XTreeWidgetExportThread(const QStringList &header,
+                            XTreeWidgetExporter::Format format,
+                            const QString &filename,
+                            XTreeWidgetExporter::Options options,
+                            QObject *parent = 0);
+
+    void    appendRows(const XTreeWidgetRows &rows, bool last);
+    QString errorString() const;
+    QString fileName()    const { return _filename;    }
+
+  public slots:
+    void    cancel(const QString &errorString = QString());
+
+  signals:
+    void    rowsWanted();
+
+  protected:
+    virtual void run();
+
+  private:
+    QStringList                  _header;
+    XTreeWidgetExporter::Format  _format;
+    QString                      _filename;
+    XTreeWidgetExporter::Options _options;
+
+    mutable QMutex               _mutex;
+    QWaitCondition               _wake;
+    QQueue<XTreeWidgetRows>      _queue;
+    bool                         _last;
+    bool                         _cancelled;
+    QString                      _errorString;
+};
+
+#endif
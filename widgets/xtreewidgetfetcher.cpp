@@ -0,0 +1,239 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetfetcher.h"
+
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTimer>
+
+#include <metasql.h>
+
+#include "xsqlquery.h"
+
+#define DEBUG false
+
+// rows per rowsReady() signal
+#define FETCHROWS 500
+
+// ms to wait for a cancelled statement before ending its session
+#define CANCELTIMEOUT 5000
+
+XTreeWidgetQueryRow::XTreeWidgetQueryRow(const XSqlQuery &query)
+  : _query(query)
+{
+}
+
+QVariant XTreeWidgetQueryRow::value(int field) const
+{
+  return _query.value(field);
+}
+
+XTreeWidgetRowBatch::XTreeWidgetRowBatch(int fieldCount)
+  : _fieldCount(fieldCount)
+{
+}
+
+void XTreeWidgetRowBatch::append(const QSqlQuery &query)
+{
+  for (int i = 0; i < _fieldCount; i++)
+    _values.append(query.value(i));
+}
+
+/* row must hold fieldCount() values */
+void XTreeWidgetRowBatch::append(const QVector<QVariant> &row)
+{
+  for (int i = 0; i < _fieldCount; i++)
+    _values.append(row.value(i));
+}
+
+void XTreeWidgetRowBatch::clear()
+{
+  _values.clear();
+}
+
+int XTreeWidgetRowBatch::rowCount() const
+{
+  return _fieldCount ? _values.size() / _fieldCount : 0;
+}
+
+QVariant XTreeWidgetRowBatch::value(int row, int field) const
+{
+  if (field < 0 || field >= _fieldCount)
+    return QVariant();
+  return _values.value(row * _fieldCount + field);
+}
+
+XTreeWidgetBatchRow::XTreeWidgetBatchRow(const XTreeWidgetRowBatch &batch, int row)
+  : _batch(batch),
+    _row(row)
+{
+}
+
+QVariant XTreeWidgetBatchRow::value(int field) const
+{
+  return _batch.value(_row, field);
+}
+
+/*! Prepare to run \a metasql with \a params on a session opened with
+    \a connection, by default a copy of the current database connection.
+    \a bindings are bound by name after the MetaSQL has been expanded, for
+    placeholders the MetaSQL itself does not fill. Construct this on the
+    GUI thread so it can capture the connection.
+ */
+XTreeWidgetFetchThread::XTreeWidgetFetchThread(const QString &metasql,
+                                               const ParameterList &params,
+                                               const QMap<QString, QVariant> &bindings,
+                                               QObject *parent,
+                                               const DbConnection &connection)
+  : QThread(parent),
+    _connection(connection),
+    _metasql(metasql),
+    _params(params),
+    _bindings(bindings),
+    _cancelled(0),
+    _backendPid(0)
+{
+  qRegisterMetaType<QSqlRecord>("QSqlRecord");
+  qRegisterMetaType<XTreeWidgetRowBatch>("XTreeWidgetRowBatch");
+}
+
+/*! Stop fetching after the current row and cancel the statement if the
+    server is still executing it. If the thread hasn't finished within
+    CANCELTIMEOUT the server session is ended with terminateBackend().
+    Batches already queued to the GUI thread are still delivered.
+
+    Call this from the GUI thread, which sends the cancel on its own
+    database connection, or on a new session for a replica.
+ */
+void XTreeWidgetFetchThread::cancel()
+{
+  if (! _cancelled.testAndSetOrdered(0, 1))
+    return;
+
+  if (isRunning() && signalBackend("pg_cancel_backend"))
+    QTimer::singleShot(CANCELTIMEOUT, this, SLOT(sCancelTimeout()));
+}
+
+bool XTreeWidgetFetchThread::isCancelled() const
+{
+  return _cancelled.loadAcquire() != 0;
+}
+
+/*! End the server session running the query, for statements that ignore
+    a cancel request. The worker sees its connection fail and finishes.
+ */
+void XTreeWidgetFetchThread::terminateBackend()
+{
+  if (isRunning())
+    signalBackend("pg_terminate_backend");
+}
+
+void XTreeWidgetFetchThread::sCancelTimeout()
+{
+  if (DEBUG)
+    qDebug("XTreeWidgetFetchThread::sCancelTimeout() running %d", isRunning());
+  terminateBackend();
+}
+
+/* pg_cancel_backend() interrupts the backend the same way a libpq cancel
+   request does, without needing the worker's connection handle
+ */
+bool XTreeWidgetFetchThread::signalBackend(const QString &function)
+{
+  int pid = _backendPid.loadAcquire();
+  if (pid == 0)
+    return false;
+
+  // the pid is only meaningful on the server the worker connected to
+  QString name;
+  QString errmsg;
+  bool    result = false;
+  {
+    QSqlDatabase db = QSqlDatabase::database();
+    if (_connection.isReplica())
+    {
+      name = DbConnection::uniqueName("xtreewidgetcancel");
+      db   = _connection.open(name, errmsg);
+    }
+
+    QSqlQuery signal(db);
+    signal.prepare(QString("SELECT %1(:pid) AS result;").arg(function));
+    signal.bindValue(":pid", pid);
+    if (signal.exec() && signal.first())
+      result = signal.value("result").toBool();
+    else if (DEBUG)
+      qDebug("XTreeWidgetFetchThread::signalBackend(%s) %s %s",
+             qPrintable(function), qPrintable(errmsg),
+             qPrintable(signal.lastError().text()));
+  }
+  if (! name.isEmpty())
+    DbConnection::remove(name);
+
+  return result;
+}
+
+void XTreeWidgetFetchThread::run()
+{
+  QString name = DbConnection::uniqueName("xtreewidgetfetch");
+  {
+    QSqlDatabase db = _connection.open(name, _errorString);
+    if (! db.isOpen())
+      return;
+
+    {
+      QSqlQuery pid(db);
+      if (pid.exec("SELECT pg_backend_pid() AS pid;") && pid.first())
+        _backendPid.storeRelease(pid.value("pid").toInt());
+    }
+
+    MetaSQLQuery mql(_metasql);
+    if (! mql.isValid())
+      _errorString = mql.parseLog();
+    else
+    {
+      // plain QSqlQuery: XSqlQuery reports errors through the GUI
+      QSqlQuery query = mql.toQuery(_params, db, false);
+      query.setForwardOnly(true);
+      for (QMap<QString, QVariant>::const_iterator it = _bindings.constBegin();
+           it != _bindings.constEnd(); ++it)
+        query.bindValue(it.key(), it.value());
+
+      if (! isCancelled() && ! query.exec())
+        _errorString = query.lastError().text();
+      else if (! isCancelled())
+      {
+        QSqlRecord record = query.record();
+        emit recordReady(record, query.size());
+
+        XTreeWidgetRowBatch batch(record.count());
+        while (! isCancelled() && query.next())
+        {
+          batch.append(query);
+          if (batch.rowCount() >= FETCHROWS)
+          {
+            emit rowsReady(batch);
+            batch.clear();
+          }
+        }
+        if (batch.rowCount() > 0 && ! isCancelled())
+          emit rowsReady(batch);
+
+        if (query.lastError().type() != QSqlError::NoError)
+          _errorString = query.lastError().text();
+      }
+    }
+  }
+  _backendPid.storeRelease(0);
+  DbConnection::remove(name);
+
+  if (DEBUG)
+    qDebug("XTreeWidgetFetchThread::run() done %s", qPrintable(_errorString));
+}
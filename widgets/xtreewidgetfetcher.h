@@ -0,0 +1,132 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETFETCHER_H
+#define XTREEWIDGETFETCHER_H
+
+#include <QAtomicInt>
+#include <QMap>
+#include <QMetaType>
+#include <QSqlRecord>
+#include <QThread>
+#include <QVariant>
+#include <QVector>
+
+#include <parameter.h>
+
+#include "dbconnection.h"
+#include "widgets.h"
+
+class QSqlQuery;
+class XSqlQuery;
+
+/* One result row as XTreeWidget::populate() sees it,
+   whether it comes from a live XSqlQuery or a fetched batch.
+ */
+class XTreeWidgetRow
+{
+  public:
+    virtual ~XTreeWidgetRow() {}
+    virtual QVariant value(int field) const = 0;
+};
+
+class XTreeWidgetQueryRow : public XTreeWidgetRow
+{
+  public:
+    XTreeWidgetQueryRow(const XSqlQuery &query);
+    virtual QVariant value(int field) const;
+
+  private:
+    const XSqlQuery &_query;
+};
+
+/* A block of rows copied out of a query on a worker thread. Values are
+   stored row after row in one vector so a batch costs one allocation
+   no matter how many rows or columns it holds.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetRowBatch
+{
+  public:
+    XTreeWidgetRowBatch(int fieldCount = 0);
+
+    void      append(const QSqlQuery &query);
+    void      append(const QVector<QVariant> &row);
+    void      clear();
+    int       fieldCount() const { return _fieldCount; }
+    int       rowCount()   const;
+    QVariant  value(int row, int field) const;
+
+  private:
+    int               _fieldCount;
+    QVector<QVariant> _values;
+};
+
+Q_DECLARE_METATYPE(XTreeWidgetRowBatch)
+
+class XTreeWidgetBatchRow : public XTreeWidgetRow
+{
+  public:
+    XTreeWidgetBatchRow(const XTreeWidgetRowBatch &batch, int row = 0);
+    virtual QVariant value(int field) const;
+    void     setRow(int row) { _row = row; }
+
+  private:
+    const XTreeWidgetRowBatch &_batch;
+    int                        _row;
+};
+
+/* Runs a MetaSQL query on its own database connection and hands the
+   results to the GUI thread in batches: first recordReady() with the
+   column layout, then rowsReady() until the rows run out or cancel()
+   is called, then QThread::finished(). Check errorString() once
+   finished() has been emitted.
+
+   cancel() also asks the server to abandon the statement, so a query
+   that is still executing stops using the database right away instead
+   of running to completion in the background.
+ */
+class XTreeWidgetFetchThread : public QThread
+{
+  Q_OBJECT
+
+  public:
+    XTreeWidgetFetchThread(const QString &metasql, const ParameterList &params,
+                           const QMap<QString, QVariant> &bindings,
+                           QObject *parent = 0,
+                           const DbConnection &connection = DbConnection());
+
+    void     cancel();
+    bool     isCancelled() const;
+    void     terminateBackend();
+    QString  errorString() const { return _errorString; }
+
+  signals:
+    void recordReady(const QSqlRecord &record, int size);
+    void rowsReady(const XTreeWidgetRowBatch &batch);
+
+  protected:
+    virtual void run();
+
+  private slots:
+    void sCancelTimeout();
+
+  private:
+    bool     signalBackend(const QString &function);
+
+    DbConnection            _connection;
+    QString                 _metasql;
+    ParameterList           _params;
+    QMap<QString, QVariant> _bindings;
+    QString                 _errorString;
+    QAtomicInt              _cancelled;
+    QAtomicInt              _backendPid;  // 0 until the session is open
+};
+
+#endif
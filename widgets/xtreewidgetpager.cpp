@@ -0,0 +1,374 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetpager.h"
+
+#include <QApplication>
+#include <QHeaderView>
+#include <QScrollBar>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QSqlField>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+#include <metasql.h>
+
+#include "dbconnection.h"
+#include "xsqlquery.h"
+#include "xtreewidget.h"
+
+#define DEBUG false
+
+#define PAGEROWS 500
+
+XTreeWidgetPager::XTreeWidgetPager(XTreeWidget *list)
+  : QObject(list),
+    _list(list),
+    _pageSize(PAGEROWS),
+    _useAltId(false),
+    _fetching(false),
+    _first(true),
+    _ordered(false),
+    _index(-1)
+{
+  _list->_pager = this;
+  connect(_list->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(sScrolled(int)));
+}
+
+XTreeWidgetPager::~XTreeWidgetPager()
+{
+  close();
+}
+
+void XTreeWidgetPager::setPageSize(int rows)
+{
+  _pageSize = qMax(1, rows);
+}
+
+/*! Replace the contents of the list with the first page of \a metasql.
+    \a bindings are bound by name after the MetaSQL has been expanded.
+    Returns false and emits failed() if the cursor could not be opened.
+ */
+bool XTreeWidgetPager::open(const QString &metasql, const ParameterList &params,
+                            const QMap<QString, QVariant> &bindings,
+                            int pIndex, bool pUseAltId)
+{
+  close();
+  _errorString.clear();
+  _fields.clear();
+  _useAltId = pUseAltId;
+  _index    = pIndex;
+
+  QString name = DbConnection::uniqueName("xtreewidgetpager");
+  QString errmsg;
+  QSqlDatabase db = DbConnection().open(name, errmsg);
+  if (! db.isOpen())
+    return fail(errmsg);
+  _connection = name;
+
+  MetaSQLQuery mql(metasql);
+  if (! mql.isValid())
+    return fail(mql.parseLog());
+
+  QSqlQuery query = mql.toQuery(params, db, false);
+  for (QMap<QString, QVariant>::const_iterator it = bindings.constBegin();
+       it != bindings.constEnd(); ++it)
+    query.bindValue(it.key(), it.value());
+
+  _sql = inlineBindings(query);
+  if (_sql.isEmpty())
+    return fail(_errorString);
+
+  /* have the server return the rows in the order the list shows them,
+     so later pages can be appended without sorting the list again
+   */
+  QSqlQuery fields(db);
+  if (! fields.exec(QString("SELECT * FROM (%1) AS xtpagerquery LIMIT 0;").arg(_sql)))
+    return fail(fields.lastError().text());
+  QSqlRecord record = fields.record();
+  for (int i = 0; i < record.count(); i++)
+    _fields.append(record.fieldName(i));
+
+  QString orderBy;
+  if (_list->header()->isSortIndicatorShown() && _list->sortColumn() >= 0)
+    orderBy = this->orderBy(_list->sortColumn(), _list->header()->sortIndicatorOrder());
+  _ordered = ! orderBy.isEmpty() ||
+             ! _list->header()->isSortIndicatorShown() || _list->sortColumn() < 0;
+
+  if (! declare(orderBy))
+    return false;
+
+  return fetchMore();
+}
+
+static bool isIdentifierChar(const QChar &c)
+{
+  return c.isLetterOrNumber() || c == '_' || c == '$';
+}
+
+/* DECLARE can't take bind parameters, so write the bound values
+   into the statement as literals, quoted by the database driver.
+ */
+QString XTreeWidgetPager::inlineBindings(const QSqlQuery &query)
+{
+  QString                 sql    = query.lastQuery();
+  QMap<QString, QVariant> values = query.boundValues();
+  const QSqlDriver       *driver = query.driver();
+
+  QString result;
+  result.reserve(sql.size());
+  QChar quote;
+  bool  escapes = false;                        // E'...' takes \' as a quote
+  int   n = sql.size();
+  for (int i = 0; i < n; i++)
+  {
+    QChar c = sql.at(i);
+    if (! quote.isNull())                       // inside '...' or "..."
+    {
+      if (escapes && c == '\\' && i + 1 < n)
+      {
+        result += c;
+        c = sql.at(++i);
+      }
+      else if (c == quote)
+        quote = QChar();
+      result += c;
+    }
+    else if (c == '\'' || c == '"')
+    {
+      quote   = c;
+      escapes = (c == '\'' && i > 0 && sql.at(i - 1).toUpper() == 'E' &&
+                 (i == 1 || ! isIdentifierChar(sql.at(i - 2))));
+      result += c;
+    }
+    else if (c == '$' && (i == 0 || ! isIdentifierChar(sql.at(i - 1))))
+    {
+      // $tag$...$tag$ runs to the same tag, whatever it contains
+      int tagend = i + 1;
+      while (tagend < n && (sql.at(tagend).isLetter() || sql.at(tagend) == '_' ||
+                            (tagend > i + 1 && sql.at(tagend).isDigit())))
+        tagend++;
+      if (tagend < n && sql.at(tagend) == '$')
+      {
+        QString tag = sql.mid(i, tagend - i + 1);
+        int end = sql.indexOf(tag, tagend + 1);
+        end = (end < 0) ? n : end + tag.size();
+        result += sql.mid(i, end - i);
+        i = end - 1;
+      }
+      else
+        result += c;
+    }
+    else if (c == '-' && i + 1 < n && sql.at(i + 1) == '-')
+    {
+      int end = sql.indexOf('\n', i);
+      if (end < 0)
+        end = n;
+      result += sql.mid(i, end - i);
+      i = end - 1;
+    }
+    else if (c == '/' && i + 1 < n && sql.at(i + 1) == '*')
+    {
+      int end = sql.indexOf("*/", i + 2);
+      end = (end < 0) ? n : end + 2;
+      result += sql.mid(i, end - i);
+      i = end - 1;
+    }
+    else if (c == '?')
+    {
+      _errorString = tr("Queries with positional parameters cannot be paged.");
+      return QString();
+    }
+    else if (c == ':' && i + 1 < n &&
+             (sql.at(i + 1).isLetter() || sql.at(i + 1) == '_') &&
+             (i == 0 || sql.at(i - 1) != ':'))  // not a :: cast
+    {
+      int end = i + 1;
+      while (end < n && (sql.at(end).isLetterOrNumber() || sql.at(end) == '_'))
+        end++;
+      QString placeholder = sql.mid(i, end - i);
+      if (values.contains(placeholder))
+      {
+        QVariant  value = values.value(placeholder);
+        QSqlField field(QString(), value.type());
+        field.setValue(value);
+        result += driver->formatValue(field);
+      }
+      else
+        result += placeholder;
+      i = end - 1;
+    }
+    else
+      result += c;
+  }
+
+  // the statement becomes part of DECLARE, so it can't end itself
+  while (! result.isEmpty() &&
+         (result.endsWith(';') || result.at(result.size() - 1).isSpace()))
+    result.chop(1);
+
+  if (DEBUG)
+    qDebug("XTreeWidgetPager::inlineBindings() %s", qPrintable(result));
+  return result;
+}
+
+bool XTreeWidgetPager::declare(const QString &orderBy)
+{
+  QString sql = orderBy.isEmpty() ? _sql :
+                QString("SELECT * FROM (%1) AS xtpagerquery ORDER BY %2").arg(_sql, orderBy);
+
+  QSqlQuery cursor(QSqlDatabase::database(_connection, false));
+  if (! cursor.exec("BEGIN;") ||
+      ! cursor.exec("DECLARE xtpager NO SCROLL CURSOR FOR " + sql + ";"))
+    return fail(cursor.lastError().text());
+
+  _first = true;
+  return true;
+}
+
+bool XTreeWidgetPager::fail(const QString &message)
+{
+  close();
+  _errorString = message;
+  emit failed(message);
+  return false;
+}
+
+/*! Add the next page of rows to the list.
+    Returns false if there are no more or fetching them failed.
+ */
+bool XTreeWidgetPager::fetchMore()
+{
+  if (! isOpen() || _fetching)
+    return false;
+
+  _fetching = true;
+  XSqlQuery page(QSqlDatabase::database(_connection, false));
+  if (! page.exec(QString("FETCH FORWARD %1 FROM xtpager;").arg(_pageSize)))
+  {
+    _fetching = false;
+    return fail(page.lastError().text());
+  }
+
+  bool last = page.size() < _pageSize;
+
+  // populate() adds a new total row for each page
+  bool totals = false;
+  for (int col = 0; col < _list->headerItem()->columnCount(); col++)
+    totals |= (_list->headerItem()->data(col, Qt::UserRole).toString() == "xttotalrole");
+  for (int i = _list->topLevelItemCount() - 1; totals && ! _first && i >= 0; i--)
+  {
+    if (_list->topLevelItem(i)->data(0, Qt::UserRole).toString() == "totalrole")
+      delete _list->takeTopLevelItem(i);
+  }
+
+  // the rows must be in the list before anyone asks for more
+  bool linear = _list->_alwaysLinear;
+  _list->_alwaysLinear = true;
+  if (! _first && _ordered)   // only add this page to the sort and totals
+    _list->_appendedFrom = _list->topLevelItemCount();
+  _list->populate(page, _first ? _index : _list->id(), _useAltId,
+                  _first ? XTreeWidget::Replace : XTreeWidget::Append);
+  _list->_appendedFrom = -1;
+  _list->_alwaysLinear = linear;
+  _first = false;
+
+  if (DEBUG)
+    qDebug("XTreeWidgetPager::fetchMore() got %d rows, %d in list",
+           page.size(), _list->topLevelItemCount());
+
+  _fetching = false;
+  if (last)
+    close();
+
+  return true;
+}
+
+/*! Add every row that hasn't been fetched yet. */
+void XTreeWidgetPager::fetchAll()
+{
+  if (! isOpen())
+    return;
+
+  qApp->setOverrideCursor(Qt::WaitCursor);
+  while (fetchMore())
+    ;
+  qApp->restoreOverrideCursor();
+}
+
+/*! Stop paging and release the cursor and its database session.
+    The rows already in the list stay there.
+ */
+void XTreeWidgetPager::close()
+{
+  if (_connection.isEmpty())
+    return;
+
+  {
+    QSqlDatabase db = QSqlDatabase::database(_connection, false);
+    if (db.isOpen())
+    {
+      QSqlQuery rollback(db);
+      rollback.exec("ROLLBACK;");
+    }
+  }
+  DbConnection::remove(_connection);
+  _connection.clear();
+}
+
+/*! Sort the list by \a column. While rows are still on the server this
+    reopens the cursor ordered by that column and shows its first page.
+    Returns false if the list should sort itself instead.
+ */
+bool XTreeWidgetPager::sort(int column, Qt::SortOrder order)
+{
+  if (! isOpen())
+    return false;
+
+  QString orderBy = this->orderBy(column, order);
+  if (orderBy.isEmpty())
+    return false;
+
+  QSqlDatabase db = QSqlDatabase::database(_connection, false);
+  {
+    QSqlQuery rollback(db);
+    rollback.exec("ROLLBACK;");
+  }
+
+  _index   = _list->id();
+  _ordered = true;
+  _list->sortItems(column, order);  // so populate() keeps this order
+  if (declare(orderBy))
+    fetchMore();
+
+  return true;
+}
+
+/* the ORDER BY for the field shown in list \a column,
+   or an empty string if the query doesn't return one
+ */
+QString XTreeWidgetPager::orderBy(int column, Qt::SortOrder order) const
+{
+  QString name = _list->column(column);
+  if (name.isEmpty() || ! _fields.contains(name))
+    return QString();
+
+  QSqlDatabase db = QSqlDatabase::database(_connection, false);
+  return db.driver()->escapeIdentifier(name, QSqlDriver::FieldName) +
+         (order == Qt::AscendingOrder ? " ASC" : " DESC");
+}
+
+void XTreeWidgetPager::sScrolled(int value)
+{
+  QScrollBar *bar = _list->verticalScrollBar();
+  if (isOpen() && value >= bar->maximum() - bar->pageStep())
+    fetchMore();
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETPAGER_H
+#define XTREEWIDGETPAGER_H
+
+#include <QMap>
+#include <QObject>
+#include <QStringList>
+#include <QVariant>
+
+#include <parameter.h>
+
+#include "widgets.h"
+
+class QSqlQuery;
+class XTreeWidget;
+
+/* Fills an XTreeWidget a page at a time from a server-side cursor.
+
+   open() declares a cursor for the query on a separate database session,
+   so the transaction the cursor needs doesn't hold up the application's
+   own, and shows the first page. The cursor is ordered by the column the
+   list is sorted on, so the next page, fetched when the list is scrolled
+   near its end, is appended without sorting the whole list again. XTreeWidget fetches the remaining rows
+   before exporting or copying the list, and hands header clicks to
+   sort(), which orders the query on the server while rows are still
+   missing so the first page holds the right rows.
+ */
+class XTUPLEWIDGETS_EXPORT XTreeWidgetPager : public QObject
+{
+  Q_OBJECT
+
+  public:
+    XTreeWidgetPager(XTreeWidget *list);
+    ~XTreeWidgetPager();
+
+    bool    open(const QString &metasql, const ParameterList &params,
+                 const QMap<QString, QVariant> &bindings = QMap<QString, QVariant>(),
+                 int pIndex = -1, bool pUseAltId = false);
+    bool    isOpen()      const { return ! _connection.isEmpty(); }
+    bool    isFetching()  const { return _fetching; }
+    QString errorString() const { return _errorString; }
+    int     pageSize()    const { return _pageSize; }
+    void    setPageSize(int rows);
+    bool    sort(int column, Qt::SortOrder order);
+
+  public slots:
+    bool    fetchMore();
+    void    fetchAll();
+    void    close();
+
+  signals:
+    void    failed(const QString &message);
+
+  private slots:
+    void    sScrolled(int value);
+
+  private:
+    bool    declare(const QString &orderBy);
+    bool    fail(const QString &message);
+    QString orderBy(int column, Qt::SortOrder order) const;
+    QString inlineBindings(const QSqlQuery &query);
+
+    XTreeWidget *_list;
+    QString      _connection;
+    QString      _sql;
+    QStringList  _fields;
+    QString      _errorString;
+    int          _pageSize;
+    bool         _useAltId;
+    bool         _fetching;
+    bool         _first;
+    bool         _ordered;     // the cursor returns rows in the list's order
+    int          _index;
+};
+
+#endif
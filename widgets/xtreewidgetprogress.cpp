@@ -10,6 +10,7 @@
 
 #include "xtreewidgetprogress.h"
 
+#include <QAction>
 #include <QBoxLayout>
 #include <QHBoxLayout>
 #include <QGridLayout>
@@ -43,6 +44,13 @@ XTreeWidgetProgress::XTreeWidgetProgress(XTreeWidget *parent)
     connect(_cancel, SIGNAL(clicked()), this,    SIGNAL(cancel()));
     connect(_cancel, SIGNAL(clicked()), this,    SLOT(hide()));
 
+    // only active while the progress bar is visible
+    QAction *escapeAct = new QAction(this);
+    escapeAct->setShortcut(QKeySequence(Qt::Key_Escape));
+    escapeAct->setShortcutContext(Qt::WindowShortcut);
+    connect(escapeAct, SIGNAL(triggered()), _cancel, SLOT(click()));
+    addAction(escapeAct);
+
     _lyt = new QHBoxLayout();
     _lyt->addWidget(_pb);
     _lyt->addWidget(_cancel);
@@ -0,0 +1,196 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetresultset.h"
+
+#include <cmath>
+
+#include <QLocale>
+
+#include "xt.h"
+
+#define DEBUG false
+
+// keep in sync with cint() and round() in xtreewidget.cpp - Issue #8897
+static double cint(double x)
+{
+  double intpart, fractpart;
+  fractpart = modf(x, &intpart);
+
+  if (fabs(fractpart) >= 0.5)
+    return x>=0 ? ceil(x) : floor(x);
+  else
+    return x<0 ? ceil(x) : floor(x);
+}
+
+static double round(double r, int places)
+{
+  double off=pow(10.0,places);
+  return cint(r*off)/off;
+}
+
+XTreeWidgetResultSet::XTreeWidgetResultSet(int fieldCount,
+                                           const QVector<int> &colIdx,
+                                           const QVector<int *> &colRole,
+                                           const XTreeWidgetColumnPlan &plan)
+  : _fields(fieldCount),
+    _colIdx(colIdx),
+    _colRole(colIdx.size() * COLROLE_COUNT, 0),
+    _plan(plan),
+    _rowCount(0)
+{
+  for (int col = 0; col < colRole.size() && col < _colIdx.size(); col++)
+  {
+    if (colRole.at(col))
+      for (int k = 0; k < COLROLE_COUNT; k++)
+        _colRole[col * COLROLE_COUNT + k] = colRole.at(col)[k];
+  }
+}
+
+/* copy the current row of the query, returning its row number */
+int XTreeWidgetResultSet::appendRow(const XTreeWidgetRow &row)
+{
+  for (int i = 0; i < _fields.size(); i++)
+    _fields[i].append(row.value(i));
+  return _rowCount++;
+}
+
+QVariant XTreeWidgetResultSet::value(int row, int field) const
+{
+  if (field < 0 || field >= _fields.size() || row < 0 || row >= _rowCount)
+    return QVariant();
+  return _fields.at(field).at(row);
+}
+
+/* populateWorker() skips optional role columns that are missing or NULL */
+QVariant XTreeWidgetResultSet::nonNullValue(int row, int field) const
+{
+  if (field <= 0)
+    return QVariant();
+
+  QVariant result = value(row, field);
+  return result.isNull() ? QVariant() : result;
+}
+
+int XTreeWidgetResultSet::colRole(int column, int colrole) const
+{
+  return _colRole.at(column * COLROLE_COUNT + colrole);
+}
+
+/* the numeric scale for a cell, as populateWorker() computes it.
+   numericrole gets the value of the xtnumericrole column, if any.
+ */
+int XTreeWidgetResultSet::scale(int row, int column, QString *numericrole) const
+{
+  int scale = _plan.defaultScale();
+  int numericidx = colRole(column, COLROLE_NUMERIC);
+  // Negative NUMERIC ROLE => default for column instead of column index
+  if (numericidx < 0)
+    scale = 0 - numericidx;
+  else if (numericidx > 0)
+  {
+    QString role = value(row, numericidx).toString();
+    scale = _plan.scale(role);
+    if (numericrole)
+      *numericrole = role;
+  }
+  return scale;
+}
+
+/* return what populateWorker() would have stored in the item
+   for the given role, or an invalid QVariant if it stores nothing.
+ */
+QVariant XTreeWidgetResultSet::data(int row, int column, int role) const
+{
+  if (column < 0 || column >= _colIdx.size() || row < 0 || row >= _rowCount)
+    return QVariant();
+
+  QVariant rawValue = value(row, _colIdx.at(column));
+
+  switch (role)
+  {
+    case Xt::RawRole:
+      return rawValue;
+
+    case Xt::ScaleRole:
+      if (colRole(column, COLROLE_NUMERIC) ||
+          colRole(column, COLROLE_RUNNING) ||
+          colRole(column, COLROLE_TOTAL))
+        return scale(row, column);
+      break;
+
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+    {
+      QString numericrole;
+      int     cellscale  = scale(row, column, &numericrole);
+      int     displayidx = colRole(column, COLROLE_DISPLAY);
+      /* if qtdisplayrole IS NULL then let the raw value shine through.
+         see populateWorker() for details.
+      */
+      if (displayidx && !value(row, displayidx).isNull())
+      {
+        QVariant field = value(row, displayidx);
+        if (field.type() == QVariant::Int)
+          return _plan.locale().toString(field.toInt());
+        else if (field.type() == QVariant::Double)
+          return _plan.locale().toString(field.toDouble(), 'f', cellscale);
+        return field.toString();
+      }
+      else if (rawValue.isNull())
+        return colRole(column, COLROLE_NULL) ?
+               value(row, colRole(column, COLROLE_NULL)).toString() : QString("");
+      else if (colRole(column, COLROLE_NUMERIC) &&
+               (numericrole == "percent" || numericrole == "scrap"))
+        return _plan.locale().toString(rawValue.toDouble() * 100.0, 'f', cellscale);
+      else if (colRole(column, COLROLE_NUMERIC) || rawValue.type() == QVariant::Double)
+        return _plan.locale().toString(round(rawValue.toDouble(), cellscale), 'f', cellscale);
+      else if (rawValue.type() == QVariant::Bool)
+        return rawValue.toBool() ? QObject::tr("Yes") : QObject::tr("No");
+      return rawValue;
+    }
+
+    case Qt::TextAlignmentRole:
+      if (! colRole(column, COLROLE_TEXTALIGNMENT))
+        return _plan.alignment(column);
+      return nonNullValue(row, colRole(column, COLROLE_TEXTALIGNMENT));
+
+    case Qt::ForegroundRole:
+    case Qt::BackgroundRole:
+    {
+      QVariant color = nonNullValue(row, colRole(column, role == Qt::ForegroundRole ?
+                                                         COLROLE_FOREGROUND :
+                                                         COLROLE_BACKGROUND));
+      if (color.isValid())
+        return _plan.color(color.toString());
+      break;
+    }
+
+    case Qt::ToolTipRole:
+      return nonNullValue(row, colRole(column, COLROLE_TOOLTIP));
+
+    case Qt::StatusTipRole:
+      return nonNullValue(row, colRole(column, COLROLE_STATUSTIP));
+
+    case Qt::FontRole:
+      return nonNullValue(row, colRole(column, COLROLE_FONT));
+
+    case Xt::RunningInitRole:
+      return nonNullValue(row, colRole(column, COLROLE_RUNNINGINIT));
+
+    case Xt::IdRole:
+      return nonNullValue(row, colRole(column, COLROLE_ID));
+
+    default:
+      break;
+  }
+
+  return QVariant();
+}
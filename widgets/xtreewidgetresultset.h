@@ -0,0 +1,51 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETRESULTSET_H
+#define XTREEWIDGETRESULTSET_H
+
+#include <QVariant>
+#include <QVector>
+
+#include "xtreewidget.h"
+#include "xtreewidgetfetcher.h"
+
+/* Columnar copy of the rows an XTreeWidget populated with populateLazy set.
+   XTreeWidgetItems created from it keep only a row number; display text,
+   alignment, colors and the other per-cell roles are computed by data()
+   when the view asks for them, which means only for rows that get painted.
+ */
+class XTreeWidgetResultSet
+{
+  public:
+    XTreeWidgetResultSet(int fieldCount, const QVector<int> &colIdx,
+                         const QVector<int *> &colRole,
+                         const XTreeWidgetColumnPlan &plan);
+
+    int      appendRow(const XTreeWidgetRow &row);
+    int      columnCount() const { return _colIdx.size(); }
+    int      rowCount()    const { return _rowCount;      }
+    QVariant data(int row, int column, int role) const;
+    QVariant value(int row, int field) const;
+
+  protected:
+    int      colRole(int column, int colrole) const;
+    QVariant nonNullValue(int row, int field) const;
+    int      scale(int row, int column, QString *numericrole = 0) const;
+
+  private:
+    QVector<QVector<QVariant> > _fields;   // _fields[queryfield][row]
+    QVector<int>                _colIdx;   // queryfield = _colIdx[xtreecol]
+    QVector<int>                _colRole;  // queryfield = _colRole[xtreecol * COLROLE_COUNT + roleid]
+    mutable XTreeWidgetColumnPlan _plan;
+    int                         _rowCount;
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetrunningtotal.h"
+
+XTreeWidgetRunningTotal::XTreeWidgetRunningTotal()
+{
+}
+
+void XTreeWidgetRunningTotal::clear()
+{
+  _setIndex.clear();
+  _trees.clear();
+  _init.clear();
+  _rowSet.clear();
+  _rank.clear();
+  _raw.clear();
+}
+
+/* add the next row in display order and return its row number.
+   init only matters for the first row of each set.
+ */
+int XTreeWidgetRunningTotal::append(int set, double init, double value)
+{
+  int idx = _setIndex.value(set, -1);
+  if (idx < 0)
+  {
+    idx = _trees.size();
+    _setIndex.insert(set, idx);
+    _trees.append(QVector<double>(1, 0.0));
+    _init.append(init);
+  }
+  else if (_trees.at(idx).size() == 1)  // emptied by truncate()
+    _init[idx] = init;
+
+  // node i covers ranks (i - lowbit(i), i], so it adds the nodes of the
+  // lower ranks it spans to the new value
+  QVector<double> &tree = _trees[idx];
+  int    i    = tree.size();
+  double node = value;
+  for (int j = i - 1; j > i - (i & -i); j -= (j & -j))
+    node += tree.at(j);
+  tree.append(node);
+
+  _rowSet.append(idx);
+  _rank.append(i);
+  _raw.append(value);
+
+  return _raw.size() - 1;
+}
+
+/* drop every row from row number rows on. nodes only cover lower ranks,
+   so the ones left behind stay correct.
+ */
+void XTreeWidgetRunningTotal::truncate(int rows)
+{
+  if (rows < 0)
+    rows = 0;
+
+  for (int row = _raw.size() - 1; row >= rows; row--)
+    _trees[_rowSet.at(row)].removeLast();
+
+  if (rows < _raw.size())
+  {
+    _rowSet.resize(rows);
+    _rank.resize(rows);
+    _raw.resize(rows);
+  }
+}
+
+/* the running subtotal of row's set through and including row */
+double XTreeWidgetRunningTotal::value(int row) const
+{
+  if (row < 0 || row >= _raw.size())
+    return 0.0;
+
+  const QVector<double> &tree = _trees.at(_rowSet.at(row));
+  double sum = _init.at(_rowSet.at(row));
+  for (int i = _rank.at(row); i > 0; i -= (i & -i))
+    sum += tree.at(i);
+  return sum;
+}
+
+double XTreeWidgetRunningTotal::rawValue(int row) const
+{
+  return _raw.value(row);
+}
+
+void XTreeWidgetRunningTotal::setRawValue(int row, double value)
+{
+  if (row < 0 || row >= _raw.size())
+    return;
+
+  double delta = value - _raw.at(row);
+  _raw[row] = value;
+
+  QVector<double> &tree = _trees[_rowSet.at(row)];
+  for (int i = _rank.at(row); i < tree.size(); i += (i & -i))
+    tree[i] += delta;
+}
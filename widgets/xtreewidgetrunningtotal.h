@@ -0,0 +1,52 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETRUNNINGTOTAL_H
+#define XTREEWIDGETRUNNINGTOTAL_H
+
+#include <QHash>
+#include <QVector>
+
+/* The running subtotals of one xtrunningrole column.
+
+   Rows are numbered in display order. Each running set keeps its values
+   in a Fenwick (binary indexed) tree, so reading the subtotal through a
+   row, changing one row's value, appending a row or dropping the last one
+   costs O(log n). Rows before a change keep their nodes, so after an
+   insert, remove or move only the rows from that point on are appended
+   again.
+
+   As in XTreeWidget::populateCalculatedColumns(), the subtotal of a set
+   starts at the xtrunninginit value of the first row in that set.
+ */
+class XTreeWidgetRunningTotal
+{
+  public:
+    XTreeWidgetRunningTotal();
+
+    void    clear();
+    int     append(int set, double init, double value);
+    void    truncate(int rows);
+
+    int     rowCount() const { return _raw.size(); }
+    double  value(int row) const;
+    double  rawValue(int row) const;
+    void    setRawValue(int row, double value);
+
+  private:
+    QHash<int, int>           _setIndex; // running set -> index into _trees
+    QVector<QVector<double> > _trees;    // 1-based Fenwick tree per set
+    QVector<double>           _init;     // starting subtotal per set
+    QVector<int>              _rowSet;   // index into _trees for each row
+    QVector<int>              _rank;     // 1-based position of each row in its set
+    QVector<double>           _raw;
+};
+
+#endif
@@ -0,0 +1,309 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#include "xtreewidgetsearchindex.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "xtreewidgetresultset.h"
+
+#define DEBUG false
+
+static quint64 trigramKey(const QString &text, int pos)
+{
+  return (quint64(text.at(pos).unicode())     << 32) |
+         (quint64(text.at(pos + 1).unicode()) << 16) |
+          quint64(text.at(pos + 2).unicode());
+}
+
+/* orders rows by their text, keeping equal texts in row order */
+class XTreeWidgetSearchTextLess
+{
+  public:
+    XTreeWidgetSearchTextLess(const QStringList &text) : _text(text) {}
+
+    bool operator()(int row1, int row2) const
+    {
+      return _text.at(row1) < _text.at(row2);
+    }
+    bool operator()(int row, const QString &value) const
+    {
+      return _text.at(row) < value;
+    }
+
+  private:
+    const QStringList &_text;
+};
+
+XTreeWidgetSearchIndex::XTreeWidgetSearchIndex(const QList<int> &columns,
+                                               const QVector<QStringList> &texts,
+                                               int mode)
+  : _columns(columns),
+    _index(columns.size()),
+    _mode(mode),
+    _rowCount(0)
+{
+  for (int i = 0; i < _index.size() && i < texts.size(); i++)
+    _index[i].text = texts.at(i);
+  if (! texts.isEmpty())
+    _rowCount = texts.at(0).size();
+}
+
+void XTreeWidgetSearchIndex::build()
+{
+  for (int i = 0; i < _index.size(); i++)
+  {
+    ColumnIndex &index = _index[i];
+    int rows = index.text.size();
+
+    for (int row = 0; row < rows; row++)
+      index.text[row] = index.text.at(row).toCaseFolded();
+
+    index.sorted.resize(rows);
+    for (int row = 0; row < rows; row++)
+      index.sorted[row] = row;
+    std::stable_sort(index.sorted.begin(), index.sorted.end(),
+                     XTreeWidgetSearchTextLess(index.text));
+
+    buildMinTree(index);
+
+    if (_mode & Contains)
+    {
+      for (int row = 0; row < rows; row++)
+        addTrigrams(index, row);
+    }
+  }
+
+  if (DEBUG)
+    qDebug("XTreeWidgetSearchIndex::build() indexed %d rows in %d columns",
+           _rowCount, _columns.size());
+}
+
+/*! Replace the text of \a row in \a column, such as after the row's data
+    changed. The row moves to its new place in the sorted order, which
+    costs O(n) for the shift but needs no sort and no formatting.
+ */
+void XTreeWidgetSearchIndex::setText(int column, int row, const QString &text)
+{
+  int i = _columns.indexOf(column);
+  if (i < 0 || row < 0 || row >= _rowCount)
+    return;
+
+  ColumnIndex &index = _index[i];
+  QString folded = text.toCaseFolded();
+  if (folded == index.text.at(row))
+    return;
+
+  if (_mode & Contains)
+    removeTrigrams(index, row);
+  index.sorted.remove(position(index, index.text.at(row), row));
+
+  index.text[row] = folded;
+  index.sorted.insert(position(index, folded, row), row);
+  buildMinTree(index);
+  if (_mode & Contains)
+    addTrigrams(index, row);
+}
+
+/* where row belongs in index.sorted if its text were text: after lower
+   texts and after equal texts of lower rows, as stable_sort left them
+ */
+int XTreeWidgetSearchIndex::position(const ColumnIndex &index, const QString &text, int row) const
+{
+  int lo = 0;
+  int hi = index.sorted.size();
+  while (lo < hi)
+  {
+    int mid   = lo + (hi - lo) / 2;
+    int other = index.sorted.at(mid);
+    const QString &othertext = index.text.at(other);
+    if (othertext < text || (othertext == text && other < row))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* bottom-up min-tree: leaves at [rows, 2 * rows) */
+void XTreeWidgetSearchIndex::buildMinTree(ColumnIndex &index)
+{
+  int rows = index.sorted.size();
+  index.minTree.resize(2 * rows);
+  for (int k = 0; k < rows; k++)
+    index.minTree[rows + k] = index.sorted.at(k);
+  for (int k = rows - 1; k > 0; k--)
+    index.minTree[k] = qMin(index.minTree.at(2 * k), index.minTree.at(2 * k + 1));
+}
+
+/* posting lists stay in ascending row order */
+void XTreeWidgetSearchIndex::addTrigrams(ColumnIndex &index, int row)
+{
+  const QString &text = index.text.at(row);
+  for (int pos = 0; pos + 2 < text.size(); pos++)
+  {
+    QVector<int> &postings = index.trigrams[trigramKey(text, pos)];
+    QVector<int>::iterator it = std::lower_bound(postings.begin(), postings.end(), row);
+    if (it == postings.end() || *it != row)
+      postings.insert(it, row);
+  }
+}
+
+void XTreeWidgetSearchIndex::removeTrigrams(ColumnIndex &index, int row)
+{
+  const QString &text = index.text.at(row);
+  for (int pos = 0; pos + 2 < text.size(); pos++)
+  {
+    QHash<quint64, QVector<int> >::iterator found = index.trigrams.find(trigramKey(text, pos));
+    if (found == index.trigrams.end())
+      continue;
+
+    QVector<int> &postings = found.value();
+    QVector<int>::iterator it = std::lower_bound(postings.begin(), postings.end(), row);
+    if (it != postings.end() && *it == row)
+      postings.erase(it);
+    if (postings.isEmpty())
+      index.trigrams.erase(found);
+  }
+}
+
+/* the lowest row in positions [from, to) of index.sorted */
+int XTreeWidgetSearchIndex::minRow(const ColumnIndex &index, int from, int to) const
+{
+  int rows   = index.sorted.size();
+  int result = std::numeric_limits<int>::max();
+  for (from += rows, to += rows; from < to; from /= 2, to /= 2)
+  {
+    if (from & 1)
+      result = qMin(result, index.minTree.at(from++));
+    if (to & 1)
+      result = qMin(result, index.minTree.at(--to));
+  }
+  return result == std::numeric_limits<int>::max() ? -1 : result;
+}
+
+/*! The first row whose text in \a column starts with \a prefix,
+    ignoring case, or -1 if there is none or \a column isn't indexed.
+ */
+int XTreeWidgetSearchIndex::firstStartingWith(int column, const QString &prefix) const
+{
+  int i = _columns.indexOf(column);
+  if (i < 0)
+    return -1;
+
+  const ColumnIndex &index = _index.at(i);
+  QString folded = prefix.toCaseFolded();
+
+  // texts starting with folded are one contiguous run of sorted
+  int lo = int(std::lower_bound(index.sorted.constBegin(), index.sorted.constEnd(),
+                                folded, XTreeWidgetSearchTextLess(index.text))
+               - index.sorted.constBegin());
+  int hi = index.sorted.size();
+  for (int left = lo; left < hi; )
+  {
+    int mid = left + (hi - left) / 2;
+    if (index.text.at(index.sorted.at(mid)).startsWith(folded))
+      left = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return minRow(index, lo, hi);
+}
+
+/*! The first row whose text in \a column contains \a text,
+    ignoring case, or -1 if there is none or \a column isn't indexed.
+ */
+int XTreeWidgetSearchIndex::firstContaining(int column, const QString &text) const
+{
+  int i = _columns.indexOf(column);
+  if (i < 0)
+    return -1;
+
+  const ColumnIndex &index = _index.at(i);
+  QString folded = text.toCaseFolded();
+
+  if (! (_mode & Contains) || folded.size() < 3)
+  {
+    // short strings match early rows, so a scan stops quickly
+    for (int row = 0; row < index.text.size(); row++)
+      if (index.text.at(row).contains(folded))
+        return row;
+    return -1;
+  }
+
+  // every matching row is in the shortest posting list of the text's trigrams
+  const QVector<int> *candidates = 0;
+  for (int pos = 0; pos + 2 < folded.size(); pos++)
+  {
+    QHash<quint64, QVector<int> >::const_iterator it = index.trigrams.constFind(trigramKey(folded, pos));
+    if (it == index.trigrams.constEnd())
+      return -1;
+    if (! candidates || it.value().size() < candidates->size())
+      candidates = &it.value();
+  }
+
+  for (int c = 0; c < candidates->size(); c++)
+    if (index.text.at(candidates->at(c)).contains(folded))
+      return candidates->at(c);
+  return -1;
+}
+
+XTreeWidgetSearchIndexThread::XTreeWidgetSearchIndexThread(const XTreeWidgetSearchSnapshot &snapshot,
+                                                           int mode, QObject *parent)
+  : QThread(parent),
+    _snapshot(snapshot),
+    _mode(mode),
+    _index(0)
+{
+}
+
+XTreeWidgetSearchIndexThread::~XTreeWidgetSearchIndexThread()
+{
+  wait();
+  delete _index;
+}
+
+XTreeWidgetSearchIndex *XTreeWidgetSearchIndexThread::takeIndex()
+{
+  XTreeWidgetSearchIndex *result = _index;
+  _index = 0;
+  return result;
+}
+
+/* format the lazily populated cells the way XTreeWidgetItem::text()
+   would, then index the texts
+ */
+void XTreeWidgetSearchIndexThread::run()
+{
+  int rows = _snapshot.resultSet.size();
+  QVector<QStringList> texts(_snapshot.columns.size());
+  for (int i = 0; i < _snapshot.columns.size(); i++)
+  {
+    int col = _snapshot.columns.at(i);
+    texts[i].reserve(rows);
+    for (int row = 0; row < rows; row++)
+    {
+      const QVariant &value = _snapshot.values.at(i).at(row);
+      int             set   = _snapshot.resultSet.at(row);
+      if (value.isValid() || set < 0)
+        texts[i].append(value.toString());
+      else
+        texts[i].append(_snapshot.resultSets.at(set)->data(_snapshot.resultRow.at(row),
+                                                           col, Qt::DisplayRole).toString());
+    }
+  }
+  QList<int> columns = _snapshot.columns;
+  _snapshot = XTreeWidgetSearchSnapshot();  // let go of the copies
+
+  _index = new XTreeWidgetSearchIndex(columns, texts, _mode);
+  _index->build();
+}
@@ -0,0 +1,114 @@
+/*
+ * This file is part of the xTuple ERP: PostBooks Edition, a free and
+ * open source Enterprise Resource Planning software suite,
+ * Copyright (c) 1999-2017 by OpenMFG LLC, d/b/a xTuple.
+ * It is licensed to you under the Common Public Attribution License
+ * version 1.0, the full text of which (including xTuple-specific Exhibits)
+ * is available at www.xtuple.com/CPAL.  By using this software, you agree
+ * to be bound by its terms.
+ */
+
+#ifndef XTREEWIDGETSEARCHINDEX_H
+#define XTREEWIDGETSEARCHINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThread>
+#include <QVariant>
+#include <QVector>
+
+class XTreeWidgetResultSet;
+
+/* Case-insensitive lookup of the first row whose text in a column starts
+   with or contains a search string. Rows are numbered in the order the
+   texts were given, which XTreeWidget makes the top-level display order.
+
+   Every column gets a sorted prefix index: the rows whose text starts
+   with a prefix are one contiguous run of it, and a min-tree over the run
+   gives the first such row in O(log n). With Contains set, columns also
+   get a trigram index whose posting lists narrow substring searches of
+   three or more characters to a few candidate rows.
+
+   build() does all of the work and may run on any thread. setText()
+   changes one row's text afterwards without building the index again.
+ */
+class XTreeWidgetSearchIndex
+{
+  public:
+    enum Mode { StartsWith = 0x1, Contains = 0x2 };
+
+    XTreeWidgetSearchIndex(const QList<int> &columns,
+                           const QVector<QStringList> &texts, int mode);
+
+    void build();
+    void setText(int column, int row, const QString &text);
+
+    QList<int> columns()  const { return _columns; }
+    int        mode()     const { return _mode;    }
+    int        rowCount() const { return _rowCount; }
+    bool       hasColumn(int column) const { return _columns.contains(column); }
+    int        firstStartingWith(int column, const QString &prefix) const;
+    int        firstContaining(int column, const QString &text) const;
+
+  private:
+    struct ColumnIndex
+    {
+      QStringList                      text;     // case folded, by row
+      QVector<int>                     sorted;   // rows ordered by text
+      QVector<int>                     minTree;  // minimum row over runs of sorted
+      QHash<quint64, QVector<int> >    trigrams; // ascending rows per trigram
+    };
+
+    int  minRow(const ColumnIndex &index, int from, int to) const;
+    int  position(const ColumnIndex &index, const QString &text, int row) const;
+    void buildMinTree(ColumnIndex &index);
+    void addTrigrams(ColumnIndex &index, int row);
+    void removeTrigrams(ColumnIndex &index, int row);
+
+    QList<int>            _columns;
+    QVector<ColumnIndex>  _index;
+    int                   _mode;
+    int                   _rowCount;
+};
+
+/* The cells of the indexed columns as the GUI thread found them, cheap
+   to collect because nothing is formatted yet. A valid value is what the
+   item stores for display. Otherwise the row was populated lazily and is
+   formatted from resultRow of one of resultSets, private copies that the
+   worker may use without touching the list's own.
+ */
+struct XTreeWidgetSearchSnapshot
+{
+  QList<int>                                    columns;
+  QVector<QVector<QVariant> >                   values;     // [column][row]
+  QVector<int>                                  resultSet;  // by row, or -1
+  QVector<int>                                  resultRow;  // by row
+  QVector<QSharedPointer<XTreeWidgetResultSet> > resultSets;
+};
+
+/* Formats a snapshot and builds an XTreeWidgetSearchIndex from it off the
+   GUI thread. Take the result with takeIndex() after finished() is emitted.
+ */
+class XTreeWidgetSearchIndexThread : public QThread
+{
+  Q_OBJECT
+
+  public:
+    XTreeWidgetSearchIndexThread(const XTreeWidgetSearchSnapshot &snapshot,
+                                 int mode, QObject *parent = 0);
+    ~XTreeWidgetSearchIndexThread();
+
+    XTreeWidgetSearchIndex *takeIndex();
+
+  protected:
+    virtual void run();
+
+  private:
+    XTreeWidgetSearchSnapshot  _snapshot;
+    int                        _mode;
+    XTreeWidgetSearchIndex    *_index;
+};
+
+#endif